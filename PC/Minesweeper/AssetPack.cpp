@@ -0,0 +1,28 @@
+#include "Assets.h"
+#include <iostream>
+
+// ================= ASSET PACKER =================
+// Build step: decodes assetFiles from the working directory, packs them into
+// one image and writes the bundle AssetAtlas maps at startup.
+// Usage: AssetPack [bundle]
+int main(int argc, char** argv)
+{
+    std::string out = argc > 1 ? argv[1] : ASSET_BUNDLE;
+
+    sf::Image img;
+    std::vector<PackedImage> images;
+    if (!PackImages(assetFiles, img, images))
+    {
+        std::cerr << "AssetPack: some images did not load\n";
+        return 1;
+    }
+    if (!WriteBundle(out, img, images))
+    {
+        std::cerr << "AssetPack: cannot write " << out << "\n";
+        return 1;
+    }
+
+    std::cout << "Packed " << images.size() << " images into " << img.getSize().x << "x" << img.getSize().y
+              << " in " << out << "\n";
+    return 0;
+}
@@ -0,0 +1,330 @@
+#include "Assets.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <numeric>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define ATLAS_PADDING 1     // transparent gap between images, against sampling bleed
+
+const std::vector<std::string> assetFiles =
+{
+    "menu.png", "play.png", "exit.png", "easy.png", "medium.png", "hard.png",
+    "reset.png", "back.png", "error.png", "WIN.png", "NOWIN.png",
+    "0.png", "1.png", "2.png", "3.png", "4.png", "5.png", "6.png", "7.png", "8.png",
+    "mine.png", "closed.png", "flag.png",
+    "(0).png", "(1).png", "(2).png", "(3).png", "(4).png",
+    "(5).png", "(6).png", "(7).png", "(8).png", "(9).png", "colon.png"
+};
+
+namespace
+{
+// Read-only view of a whole file; empty if it could not be mapped
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string& path)
+    {
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                           FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        LARGE_INTEGER n;
+        if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &n) || n.QuadPart == 0) return;
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping) return;
+        data = (const uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (data) size = (size_t)n.QuadPart;
+#else
+        fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0 || st.st_size == 0) return;
+        void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) return;
+        data = (const uint8_t*)p;
+        size = (size_t)st.st_size;
+#endif
+    }
+
+    ~MappedFile()
+    {
+#ifdef _WIN32
+        if (data) UnmapViewOfFile(data);
+        if (mapping) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+#else
+        if (data) munmap((void*)data, size);
+        if (fd >= 0) close(fd);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const uint8_t* Data() const { return data; }
+    size_t Size() const { return size; }
+
+private:
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#else
+    int fd = -1;
+#endif
+};
+}
+
+// Width and height from a PNG's IHDR chunk, without decoding it
+static bool PngSize(const std::string& file, sf::Vector2u& size)
+{
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+    uint8_t h[24];
+    std::ifstream f(file, std::ios::binary);
+    if (!f.read((char*)h, sizeof(h)) || memcmp(h, signature, 8) != 0 || memcmp(h + 12, "IHDR", 4) != 0)
+        return false;
+
+    size.x = (unsigned)h[16] << 24 | (unsigned)h[17] << 16 | (unsigned)h[18] << 8 | h[19];
+    size.y = (unsigned)h[20] << 24 | (unsigned)h[21] << 16 | (unsigned)h[22] << 8 | h[23];
+    return size.x > 0 && size.y > 0;
+}
+
+// Shelf packing, tallest first, so images of similar height share a row.
+// Returns the atlas size.
+static sf::Vector2u PackRects(const std::vector<sf::Vector2u>& sizes, std::vector<sf::IntRect>& out)
+{
+    std::vector<size_t> order(sizes.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sizes[a].y > sizes[b].y; });
+
+    unsigned width = ATLAS_WIDTH;
+    for (const sf::Vector2u& s : sizes) width = std::max(width, s.x);
+
+    unsigned x = 0, y = 0, shelf = 0;
+    out.assign(sizes.size(), sf::IntRect());
+    for (size_t i : order)
+    {
+        if (x + sizes[i].x > width)
+        {
+            x = 0;
+            y += shelf;
+            shelf = 0;
+        }
+        out[i] = sf::IntRect((int)x, (int)y, (int)sizes[i].x, (int)sizes[i].y);
+        x += sizes[i].x + ATLAS_PADDING;
+        shelf = std::max(shelf, sizes[i].y + ATLAS_PADDING);
+    }
+    return sf::Vector2u(width, std::max(y + shelf, 1u));
+}
+
+bool PackImages(const std::vector<std::string>& files, sf::Image& img, std::vector<PackedImage>& out)
+{
+    std::vector<sf::Image> decoded(files.size());
+    std::vector<sf::Vector2u> sizes(files.size());
+    bool ok = true;
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        if (decoded[i].loadFromFile(files[i])) sizes[i] = decoded[i].getSize();
+        else ok = false;
+    }
+
+    std::vector<sf::IntRect> rects;
+    sf::Vector2u size = PackRects(sizes, rects);
+    img.create(size.x, size.y, sf::Color::Transparent);
+
+    out.clear();
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        if (sizes[i].x == 0) continue;
+        img.copy(decoded[i], (unsigned)rects[i].left, (unsigned)rects[i].top);
+        out.push_back({ files[i], rects[i] });
+    }
+    return ok;
+}
+
+bool WriteBundle(const std::string& path, const sf::Image& img, const std::vector<PackedImage>& images)
+{
+    BundleHeader h = { { 'M', 'S', 'A', 'B' }, BUNDLE_VERSION, img.getSize().x, img.getSize().y, (uint32_t)images.size() };
+
+    std::ofstream f(path, std::ios::binary | std::ios::trunc);
+    f.write((const char*)&h, sizeof(h));
+    for (const PackedImage& p : images)
+    {
+        BundleEntry e = {};
+        if (p.name.size() >= sizeof(e.name)) return false;
+        memcpy(e.name, p.name.data(), p.name.size());
+        e.x = (uint32_t)p.rect.left;
+        e.y = (uint32_t)p.rect.top;
+        e.w = (uint32_t)p.rect.width;
+        e.h = (uint32_t)p.rect.height;
+        f.write((const char*)&e, sizeof(e));
+    }
+    f.write((const char*)img.getPixelsPtr(), (std::streamsize)h.width * h.height * 4);
+    return (bool)f;
+}
+
+bool AssetAtlas::LoadBundle()
+{
+    MappedFile map(ASSET_BUNDLE);
+    const uint8_t* p = map.Data();
+    if (!p || map.Size() < sizeof(BundleHeader)) return false;
+
+    BundleHeader h;
+    memcpy(&h, p, sizeof(h));
+    size_t pixelsAt = sizeof(h) + (size_t)h.count * sizeof(BundleEntry);
+    if (memcmp(h.magic, "MSAB", 4) != 0 || h.version != BUNDLE_VERSION || h.width == 0 || h.height == 0 ||
+        map.Size() < pixelsAt + (size_t)h.width * h.height * 4)
+        return false;
+
+    images.clear();
+    for (uint32_t i = 0; i < h.count; i++)
+    {
+        BundleEntry e;
+        memcpy(&e, p + sizeof(h) + i * sizeof(e), sizeof(e));
+        if (e.x + e.w > h.width || e.y + e.h > h.height) return false;
+        images.push_back({ std::string(e.name, strnlen(e.name, sizeof(e.name))),
+                           sf::IntRect((int)e.x, (int)e.y, (int)e.w, (int)e.h) });
+    }
+
+    // Straight from the mapping to the GPU
+    if (!texture.create(h.width, h.height)) return false;
+    texture.update(p + pixelsAt);
+    return true;
+}
+
+AssetAtlas::~AssetAtlas()
+{
+    stopping = true;
+    Join();
+}
+
+bool AssetAtlas::Load(const std::vector<std::string>& first)
+{
+    bundled = LoadBundle();
+    if (bundled)
+    {
+        landed = images.size();
+        return true;
+    }
+
+    // Lay the atlas out from the headers, so every rect is final before any
+    // pixels arrive
+    std::vector<sf::Vector2u> sizes(assetFiles.size());
+    bool ok = true;
+    for (size_t i = 0; i < assetFiles.size(); i++)
+        ok = PngSize(assetFiles[i], sizes[i]) && ok;
+
+    std::vector<sf::IntRect> rects;
+    sf::Vector2u size = PackRects(sizes, rects);
+    images.clear();
+    for (size_t i = 0; i < assetFiles.size(); i++)
+        if (sizes[i].x) images.push_back({ assetFiles[i], rects[i] });
+
+    // Transparent until each image lands
+    if (!texture.create(size.x, size.y)) return false;
+    std::vector<uint8_t> clear((size_t)size.x * size.y * 4, 0);
+    texture.update(clear.data());
+
+    arrived.assign(images.size(), false);
+    landed = 0;
+    order.clear();
+    for (const std::string& name : first)
+        for (size_t i = 0; i < images.size(); i++)
+            if (images[i].name == name) order.push_back(i);
+    for (size_t i = 0; i < images.size(); i++)
+        if (std::find(order.begin(), order.end(), i) == order.end()) order.push_back(i);
+
+    unsigned n = std::clamp(std::thread::hardware_concurrency(), 1u, (unsigned)ASSET_WORKERS);
+    n = std::min(n, (unsigned)std::max<size_t>(order.size(), 1));
+    for (unsigned i = 0; i < n; i++)
+        workers.emplace_back(&AssetAtlas::Decode, this);
+    return ok;
+}
+
+// Worker: decodes images in order until there are none left
+void AssetAtlas::Decode()
+{
+    for (;;)
+    {
+        size_t k = next++;
+        if (k >= order.size() || stopping) return;
+
+        Decoded d;
+        d.index = order[k];
+        d.ok = d.image.loadFromFile(images[d.index].name);
+
+        std::lock_guard<std::mutex> g(lock);
+        ready.push_back(std::move(d));
+        decoded.notify_all();
+    }
+}
+
+void AssetAtlas::Join()
+{
+    for (std::thread& t : workers)
+        t.join();
+    workers.clear();
+}
+
+bool AssetAtlas::Poll()
+{
+    if (Done()) return false;
+
+    std::vector<Decoded> batch;
+    {
+        std::lock_guard<std::mutex> g(lock);
+        batch.swap(ready);
+    }
+
+    for (Decoded& d : batch)
+    {
+        const sf::IntRect& r = images[d.index].rect;
+        sf::Vector2u size = d.image.getSize();
+        // One that failed, or changed since its header was read, stays transparent
+        if (d.ok && size.x == (unsigned)r.width && size.y == (unsigned)r.height)
+            texture.update(d.image, (unsigned)r.left, (unsigned)r.top);
+        arrived[d.index] = true;
+        landed++;
+    }
+
+    if (Done()) Join();
+    return !batch.empty();
+}
+
+void AssetAtlas::WaitFor(const std::vector<std::string>& names)
+{
+    for (;;)
+    {
+        Poll();
+
+        bool all = true;
+        for (size_t i = 0; i < images.size(); i++)
+            if (!arrived.empty() && !arrived[i] && std::find(names.begin(), names.end(), images[i].name) != names.end())
+                all = false;
+        if (all) return;
+
+        std::unique_lock<std::mutex> g(lock);
+        decoded.wait(g, [&] { return !ready.empty(); });
+    }
+}
+
+sf::IntRect AssetAtlas::Rect(const std::string& name) const
+{
+    for (const PackedImage& p : images)
+        if (p.name == name) return p.rect;
+    return sf::IntRect();
+}
+
+sf::Sprite AssetAtlas::Sprite(const std::string& name) const
+{
+    return sf::Sprite(texture, Rect(name));
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// ================= ASSETS =================
+// Every image the client draws lives in one texture, each in its own
+// rectangle. The fast path maps ASSET_BUNDLE, which AssetPack builds from the
+// PNGs with every image already decoded and packed, and uploads its pixels
+// as they are: one file mapping and one texture upload. Without a usable
+// bundle the layout comes from the PNG headers, a few worker threads decode
+// the PNGs, and each is uploaded into its rectangle on the GL thread as it
+// lands, the ones asked for first ahead of the rest.
+
+#define ASSET_BUNDLE   "assets.bin"
+#define BUNDLE_VERSION 1
+#define ATLAS_WIDTH    1024     // wide enough for error.png; shelves grow down
+#define ASSET_WORKERS  4        // most decoding threads
+
+// Bundle layout, little-endian: BundleHeader, count BundleEntry records,
+// then width x height RGBA pixels
+struct BundleHeader
+{
+    char magic[4];              // "MSAB"
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t count;
+};
+
+struct BundleEntry
+{
+    char name[32];              // file name, e.g. "menu.png"
+    uint32_t x, y, w, h;
+};
+
+struct PackedImage
+{
+    std::string name;
+    sf::IntRect rect;
+};
+
+// The PNGs the client uses, loaded from the working directory
+extern const std::vector<std::string> assetFiles;
+
+// Decodes files and packs them into img. Files that fail to load are left
+// out; returns false if any did.
+bool PackImages(const std::vector<std::string>& files, sf::Image& img, std::vector<PackedImage>& out);
+
+bool WriteBundle(const std::string& path, const sf::Image& img, const std::vector<PackedImage>& images);
+
+class AssetAtlas
+{
+public:
+    AssetAtlas() = default;
+    AssetAtlas(const AssetAtlas&) = delete;
+    AssetAtlas& operator=(const AssetAtlas&) = delete;
+    ~AssetAtlas();
+
+    // Loads ASSET_BUNDLE, or lays out assetFiles and starts decoding them,
+    // first ahead of the rest. Every Rect is known on return; without the
+    // bundle the pixels arrive through Poll and WaitFor.
+    bool Load(const std::vector<std::string>& first = {});
+
+    // Uploads the images decoded since the last call; true if there were any.
+    // Call from the thread that owns the GL context.
+    bool Poll();
+
+    // Polls until names are in the texture, or failed to decode
+    void WaitFor(const std::vector<std::string>& names);
+
+    // Every image is in the texture or failed to decode
+    bool Done() const { return landed == images.size(); }
+
+    bool FromBundle() const { return bundled; }
+    size_t Count() const { return images.size(); }
+    const sf::Texture& GetTexture() const { return texture; }
+
+    // Where name is in the texture; an empty rect if it was not loaded
+    sf::IntRect Rect(const std::string& name) const;
+
+    // A sprite showing name at its own size
+    sf::Sprite Sprite(const std::string& name) const;
+
+private:
+    struct Decoded
+    {
+        size_t index;           // into images
+        sf::Image image;
+        bool ok;
+    };
+
+    sf::Texture texture;
+    std::vector<PackedImage> images;
+    bool bundled = false;
+
+    // Decoding; workers take images by order and hand them over in ready
+    std::vector<size_t> order;
+    std::atomic<size_t> next{ 0 };
+    std::atomic<bool> stopping{ false };
+    std::vector<std::thread> workers;
+    std::mutex lock;
+    std::condition_variable decoded;
+    std::vector<Decoded> ready;
+    std::vector<bool> arrived;  // per image, uploaded or failed
+    size_t landed = 0;
+
+    bool LoadBundle();
+    void Decode();
+    void Join();
+};
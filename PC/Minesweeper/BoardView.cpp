@@ -0,0 +1,107 @@
+#include "BoardView.h"
+#include <algorithm>
+#include <cmath>
+
+// In shown, a cell that has not been drawn since the last layout
+static const uint8_t NOT_DRAWN = 0xFD;
+
+void BoardView::SetAtlas(const AssetAtlas& assets)
+{
+    static const char* files[TILES] =
+    {
+        "0.png", "1.png", "2.png", "3.png", "4.png", "5.png", "6.png", "7.png", "8.png",
+        "mine.png", "closed.png", "flag.png"
+    };
+
+    atlas = &assets.GetTexture();
+    for (unsigned i = 0; i < TILES; i++)
+        tiles[i] = assets.Rect(files[i]);
+}
+
+// Atlas slot of a cell code; CELL_MINE is 9, so counts and the mine index directly
+unsigned BoardView::Tile(uint8_t v)
+{
+    if (v <= CELL_MINE) return v;
+    return v == CELL_FLAG ? 11 : 10;
+}
+
+void BoardView::SetBoard(const std::vector<uint8_t>& field, int n, sf::FloatRect area, float maxCell)
+{
+    float c = n > 0 ? std::min(maxCell, std::min(area.width, area.height) / n) : 0;
+    sf::Vector2f o(area.left + (area.width - n * c) / 2.f, area.top + (area.height - n * c) / 2.f);
+
+    if (n != size || c != cell || o.x != origin.x || o.y != origin.y)
+    {
+        size = n;
+        cell = c;
+        origin = o;
+
+        unsigned px = (unsigned)std::ceil(n * c);
+        if (px && (surface.getSize().x != px || surface.getSize().y != px))
+            surface.create(px, px);
+        sprite.setTexture(surface.getTexture(), true);
+        sprite.setPosition(origin);
+
+        shown.assign((size_t)n * n, NOT_DRAWN);
+        pending.clear();
+        wipe = true;
+    }
+
+    for (int i = 0; i < n; i++)
+        for (int j = 0; j < n; j++)
+            SetCell(i, j, field[(size_t)i * n + j]);
+}
+
+void BoardView::SetCell(int row, int col, uint8_t v)
+{
+    if (row < 0 || col < 0 || row >= size || col >= size) return;
+    uint8_t& s = shown[(size_t)row * size + col];
+    if (s == v) return;
+    s = v;
+
+    // Surface coordinates; the sprite puts them at origin
+    float x = col * cell, y = row * cell;
+    const sf::IntRect& t = tiles[Tile(v)];
+    float u0 = float(t.left), v0 = float(t.top), u1 = float(t.left + t.width), v1 = float(t.top + t.height);
+    pending.append(sf::Vertex(sf::Vector2f(x, y),               sf::Vector2f(u0, v0)));
+    pending.append(sf::Vertex(sf::Vector2f(x + cell, y),        sf::Vector2f(u1, v0)));
+    pending.append(sf::Vertex(sf::Vector2f(x + cell, y + cell), sf::Vector2f(u1, v1)));
+    pending.append(sf::Vertex(sf::Vector2f(x, y + cell),        sf::Vector2f(u0, v1)));
+}
+
+void BoardView::Redraw()
+{
+    std::vector<uint8_t> codes(shown);
+    shown.assign(codes.size(), NOT_DRAWN);
+    pending.clear();
+    wipe = true;
+
+    for (int i = 0; i < size; i++)
+        for (int j = 0; j < size; j++)
+            SetCell(i, j, codes[(size_t)i * size + j]);
+}
+
+void BoardView::Flush()
+{
+    if (size == 0 || (!wipe && pending.getVertexCount() == 0)) return;
+
+    if (wipe) surface.clear(sf::Color::Transparent);
+    surface.draw(pending, sf::RenderStates(atlas));
+    surface.display();
+
+    pending.clear();
+    wipe = false;
+}
+
+bool BoardView::CellAt(sf::Vector2f p, int& row, int& col) const
+{
+    if (size == 0 || p.x < origin.x || p.y < origin.y) return false;
+    col = int((p.x - origin.x) / cell);
+    row = int((p.y - origin.y) / cell);
+    return row < size && col < size;
+}
+
+void BoardView::draw(sf::RenderTarget& target, sf::RenderStates states) const
+{
+    if (size) target.draw(sprite, states);
+}
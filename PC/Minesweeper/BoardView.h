@@ -0,0 +1,59 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include "Assets.h"
+#include <cstdint>
+#include <vector>
+
+// Cell codes as the STM32 sends them; 0..8 are mine counts
+#define CELL_CLOSED 255
+#define CELL_FLAG   254
+#define CELL_MINE   9
+
+// ================= BOARD VIEW =================
+// The board is kept drawn on a render texture and shown as one sprite, so an
+// idle board costs one textured quad per frame at any size. Cells that change
+// are queued as quads over the asset texture, which holds every cell image,
+// and Flush draws just those onto the surface in one call.
+
+class BoardView : public sf::Drawable
+{
+public:
+    // Takes 0.png..8.png, mine.png, closed.png and flag.png from assets,
+    // which must outlive the view
+    void SetAtlas(const AssetAtlas& assets);
+
+    // Shows field as size x size cells centred in area, each at most maxCell
+    // pixels; big boards shrink to fit. Only cells that differ from what is
+    // shown are redrawn, unless the layout changed.
+    void SetBoard(const std::vector<uint8_t>& field, int size, sf::FloatRect area, float maxCell);
+
+    // Queues one cell for redrawing if its code changed
+    void SetCell(int row, int col, uint8_t v);
+
+    // Queues every cell again, for when atlas pixels arrived after the
+    // cells were drawn with them
+    void Redraw();
+
+    // Draws the queued cells onto the surface; call before drawing the view
+    void Flush();
+
+    // The cell under p, false outside the board
+    bool CellAt(sf::Vector2f p, int& row, int& col) const;
+
+private:
+    static const unsigned TILES = 12;   // 0..8, mine, closed, flag
+
+    const sf::Texture* atlas = nullptr;
+    sf::IntRect tiles[TILES];
+    sf::RenderTexture surface;          // the board as of the last Flush
+    sf::Sprite sprite;                  // shows surface at origin
+    sf::VertexArray pending{ sf::Quads };
+    bool wipe = false;                  // surface is stale as a whole
+    std::vector<uint8_t> shown;         // cell codes drawn or queued
+    sf::Vector2f origin;
+    float cell = 0;
+    int size = 0;
+
+    static unsigned Tile(uint8_t v);
+    void draw(sf::RenderTarget& target, sf::RenderStates states) const override;
+};
@@ -1,140 +1,947 @@
 ﻿#include <SFML/Graphics.hpp>
+#ifdef _WIN32
 #include <windows.h>
+#endif
 #include <vector>
 #include <cmath>
 #include <iostream>
 #include <string>
 #include <sstream>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <chrono>
+#include <array>
+#include <span>
+#include <algorithm>
+#include <random>
+#include "SerialTransport.h"
+#include "Protocol.h"
+#include "LinkSimulator.h"
+#include "Assets.h"
+#include "BoardView.h"
 
-// ================= PROTOCOL =================
-#define CMD_MINEFIELD 'M'
-#define CMD_CLICK     'C'
-#define CMD_ABORT     'A'
+enum class State { MAIN_MENU, DIFFICULTY_MENU, GAME, EROR };
 
-#define DIFF_EASY     'E'
-#define DIFF_MEDIUM   'M'
-#define DIFF_HARD     'H'
+// ================= SERIAL =================
+// M/C requests allowed in flight at once. While the STM32 is still sending
+// earlier replies the requests wait in its 512-byte RX ring (RX_RING_SIZE in
+// main.c); a CLICK, the larger of the two, is an 11-byte frame, so 16 of them
+// take 176 bytes and the ring would hold 46.
+#define PIPELINE_DEPTH 16
+#define STM32_RX_RING  512
+static_assert(PIPELINE_DEPTH * (TX_HEADER_SIZE + 2 + FRAME_CRC_SIZE) <= STM32_RX_RING,
+              "pipelined clicks would overrun the STM32 RX ring");
 
-#define STATUS_OK     0x00
-#define STATUS_LOSE   0x01
-#define STATUS_WIN    0x02
+// A reply counts as lost once a later one arrives, or once the line has been
+// silent this long with requests outstanding. Each lost reply is NAKed at
+// most NAK_RETRIES times before the link is given up.
+#define NAK_QUIET_MS 100
+#define NAK_RETRIES  3
 
-#define CELL_CLOSED 255
-#define CELL_FLAG   254
-#define CELL_MINE   9
+// Encodes into a stack buffer, no heap traffic per request
+bool SendPacket(SerialTransport& port, char cmd, uint8_t seq, std::span<const uint8_t> payload)
+{
+    std::array<uint8_t, MAX_REQUEST_FRAME> frame;
+    size_t n = EncodePacket(frame, cmd, seq, payload);
+    return n && port.Write(frame.data(), n);
+}
 
-enum class State { MAIN_MENU, DIFFICULTY_MENU, GAME, EROR };
+// ================= IO THREAD =================
+// Ring buffer for exactly one producer thread and one consumer thread
+template <typename T, size_t N>
+class SpscQueue
+{
+    static_assert((N & (N - 1)) == 0, "N must be a power of two");
 
-// ================= SERIAL =================
-HANDLE OpenSerial(const char* port)
+    T items[N];
+    std::atomic<size_t> head{ 0 };   // written by the producer
+    std::atomic<size_t> tail{ 0 };   // written by the consumer
+
+public:
+    bool Push(T&& v)
+    {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) == N) return false;
+        items[h & (N - 1)] = std::move(v);
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool Pop(T& v)
+    {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) return false;
+        v = std::move(items[t & (N - 1)]);
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Producer side, in place: the free slot or nullptr, then Publish()
+    T* Claim()
+    {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) == N) return nullptr;
+        return &items[h & (N - 1)];
+    }
+
+    void Publish()
+    {
+        head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Consumer side, in place: the oldest item or nullptr, then Release()
+    T* Peek()
+    {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) return nullptr;
+        return &items[t & (N - 1)];
+    }
+
+    void Release()
+    {
+        tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+};
+
+#define EVT_LINK_LOST 0     // SerialEvent::cmd when the port stops answering
+#define EVT_LINK_UP   1     // ... and when the STM32 has been found (again)
+
+// Fixed-size so that nothing crossing the queues touches the heap
+struct SerialRequest
+{
+    char cmd = 0;
+    uint8_t len = 0;
+    std::array<uint8_t, MAX_REQUEST_PAYLOAD> data;
+
+    std::span<const uint8_t> Payload() const { return { data.data(), len }; }
+};
+
+struct SerialEvent
 {
-    HANDLE h = CreateFileA(port, GENERIC_READ | GENERIC_WRITE, 0, nullptr,
-        OPEN_EXISTING, 0, nullptr);
-    if (h == INVALID_HANDLE_VALUE) return nullptr;
-
-    DCB dcb = { 0 };
-    dcb.DCBlength = sizeof(dcb);
-    GetCommState(h, &dcb);
-    dcb.BaudRate = CBR_115200;
-    dcb.ByteSize = 8;
-    dcb.StopBits = ONESTOPBIT;
-    dcb.Parity = NOPARITY;
-    SetCommState(h, &dcb);
-
-    COMMTIMEOUTS t = { 50,50,10,50,10 };
-    SetCommTimeouts(h, &t);
-    return h;
+    char cmd = 0;
+    uint8_t seq = 0;
+    uint8_t status = 0;
+    uint16_t len = 0;
+    std::array<uint8_t, MAX_PAYLOAD> data;
+
+    std::span<const uint8_t> Payload() const { return { data.data(), len }; }
+};
+
+typedef SpscQueue<SerialRequest, 64> RequestQueue;
+typedef SpscQueue<SerialEvent, 32> EventQueue;     // filled and read in place
+
+// Lets the UI thread sleep until the IO thread has published events
+class Doorbell
+{
+    std::mutex m;
+    std::condition_variable cv;
+    bool rung = false;
+
+public:
+    void Ring()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m);
+            rung = true;
+        }
+        cv.notify_one();
+    }
+
+    // False if nobody rang within timeoutMs
+    bool Wait(int timeoutMs)
+    {
+        std::unique_lock<std::mutex> lock(m);
+        bool r = cv.wait_for(lock, std::chrono::milliseconds(timeoutMs), [&]() { return rung; });
+        rung = false;
+        return r;
+    }
+};
+
+// Requests waiting for their reply, by seq. The STM32 answers in the order
+// it received requests, so sendOrder also tells which replies went missing.
+struct InFlightTable
+{
+    typedef std::chrono::steady_clock::time_point TimePoint;
+
+    bool used[256] = {};
+    TimePoint sentAt[256];
+    uint8_t naks[256] = {};
+    size_t count = 0;
+    uint8_t lastSeq = 0;
+
+    // Every in-flight seq appears once, so 256 slots always suffice
+    uint8_t sendOrder[256];
+    uint8_t orderHead = 0, orderTail = 0;
+
+    // Picks a free seq, never 0
+    uint8_t Add()
+    {
+        do lastSeq++; while (lastSeq == 0 || used[lastSeq]);
+        used[lastSeq] = true;
+        naks[lastSeq] = 0;
+        count++;
+        return lastSeq;
+    }
+
+    // Records that seq went out (again), behind everything sent before it
+    void Sent(uint8_t seq)
+    {
+        sendOrder[orderHead++] = seq;
+        sentAt[seq] = std::chrono::steady_clock::now();
+    }
+
+    // Removes seq and reports the in-flight seqs sent before it, whose
+    // replies were lost
+    template <typename F>
+    bool Remove(uint8_t seq, TimePoint& sent, F&& lost)
+    {
+        if (seq == 0 || !used[seq]) return false;
+        while (orderTail != orderHead)
+        {
+            uint8_t s = sendOrder[orderTail++];
+            if (s == seq) break;
+            if (used[s]) lost(s);
+        }
+        used[seq] = false;
+        count--;
+        sent = sentAt[seq];
+        return true;
+    }
+
+    // Reports every in-flight seq as lost, oldest first
+    template <typename F>
+    void LoseAll(F&& lost)
+    {
+        uint8_t end = orderHead;
+        while (orderTail != end)
+        {
+            uint8_t s = sendOrder[orderTail++];
+            if (used[s]) lost(s);
+        }
+    }
+};
+
+// Round trip of M/C requests, from the end of WriteFile to the decoded reply
+struct RttStats
+{
+    uint32_t count = 0;
+    double minMs = 0, maxMs = 0, sumMs = 0;
+
+    void Add(double ms)
+    {
+        if (count == 0 || ms < minMs) minMs = ms;
+        if (ms > maxMs) maxMs = ms;
+        sumMs += ms;
+        count++;
+    }
+};
+
+// Waits for room in events, for frames the UI must not miss; null only on
+// shutdown. The UI is rung first in case what fills the queue is not
+// announced yet.
+SerialEvent* ClaimEvent(EventQueue& events, Doorbell& ui, std::atomic<bool>& running)
+{
+    SerialEvent* ev = events.Claim();
+    if (ev) return ev;
+    ui.Ring();
+    while (!(ev = events.Claim()) && running.load(std::memory_order_relaxed))
+        std::this_thread::yield();
+    return ev;
 }
 
-uint8_t XOR_Checksum(const std::vector<uint8_t>& d)
+void PublishLinkEvent(EventQueue& events, Doorbell& ui, char cmd, std::atomic<bool>& running)
 {
-    uint8_t c = 0;
-    for (uint8_t b : d) c ^= b;
-    return c;
+    SerialEvent* ev = ClaimEvent(events, ui, running);
+    if (!ev) return;
+    ev->cmd = cmd;
+    ev->seq = 0;
+    ev->status = STATUS_OK;
+    ev->len = 0;
+    events.Publish();
+    ui.Ring();
 }
 
-bool SendPacket(HANDLE h, char cmd, const std::vector<uint8_t>& payload)
+// One connection's worth of SerialThread: writes queued requests and decodes
+// every incoming frame, so the render loop never waits on the serial line.
+// Sleeps in Read until a byte arrives or a new request calls Wake.
+// A reply lost to a bad CRC is NAKed; the STM32 answers with a snapshot of
+// the whole board under the lost seq, which the UI applies instead.
+// Rings ui once per batch of events, not per frame.
+// Returns once the port fails or stops answering, or on shutdown.
+void RunLink(SerialTransport& port, RequestQueue& requests, EventQueue& events, Doorbell& ui, std::atomic<bool>& running)
 {
-    std::vector<uint8_t> p;
-    p.push_back(cmd);
-    p.push_back((uint8_t)payload.size());
-    p.insert(p.end(), payload.begin(), payload.end());
-    p.push_back(XOR_Checksum(p));
-
-    DWORD w;
-    WriteFile(h, p.data(), p.size(), &w, nullptr);
-    Sleep(5);
-    return true;
+    typedef std::chrono::steady_clock Clock;
+
+    static PacketParser parser;     // 16 KB, kept off the thread stack
+    parser.Abandon();               // the tail of the previous connection
+    InFlightTable inFlight;
+    RttStats rtt;
+    uint32_t naksSent = 0;
+    bool alive = true;
+    Clock::time_point lastActivity = Clock::now();
+
+    auto Nak = [&](uint8_t seq)
+    {
+        if (!alive) return;
+        if (inFlight.naks[seq]++ == NAK_RETRIES || !SendPacket(port, CMD_NAK, seq, {}))
+        {
+            alive = false;
+            return;
+        }
+        inFlight.Sent(seq);
+        naksSent++;
+    };
+
+    while (alive && running.load(std::memory_order_relaxed))
+    {
+        // Requests past the window wait in the queue for a reply to free a slot
+        const SerialRequest* rq;
+        while (inFlight.count < PIPELINE_DEPTH && (rq = requests.Peek()))
+        {
+            bool wantsReply = rq->cmd == CMD_MINEFIELD || rq->cmd == CMD_CLICK || rq->cmd == CMD_STATE;
+            uint8_t seq = wantsReply ? inFlight.Add() : 0;
+            if (!SendPacket(port, rq->cmd, seq, rq->Payload())) { alive = false; break; }
+            if (wantsReply) inFlight.Sent(seq);
+            lastActivity = Clock::now();
+            requests.Release();
+        }
+        if (!alive) break;
+
+        uint8_t buf[512];
+        long n = port.Read(buf, sizeof(buf), inFlight.count ? NAK_QUIET_MS : -1);
+        if (n < 0) { alive = false; break; }
+
+        // Woken for a new request, or the STM32 has nothing more to send:
+        // a half-received frame is then broken, and replies still missing
+        // after what it hid is decoded are lost
+        bool quiet = n == 0 && inFlight.count &&
+                     Clock::now() - lastActivity >= std::chrono::milliseconds(NAK_QUIET_MS);
+        if (quiet) parser.Abandon();
+        if (n > 0) parser.Feed(buf, (size_t)n);
+        if (n > 0 || quiet) lastActivity = Clock::now();
+
+        PacketView pkt;
+        bool published = false;
+        while (parser.Next(pkt))
+        {
+            // A seq that is no longer in flight is a reply already replaced by a NAK snapshot
+            Clock::time_point sent;
+            if (inFlight.Remove(pkt.seq, sent, Nak))
+                rtt.Add(std::chrono::duration<double, std::milli>(Clock::now() - sent).count());
+            else if (pkt.seq != 0)
+                continue;
+
+            // Its seq is out of flight now, so nothing would NAK it: a full
+            // queue is waited out rather than dropping the frame
+            SerialEvent* ev = ClaimEvent(events, ui, running);
+            if (!ev) break;
+            ev->cmd = pkt.cmd;
+            ev->seq = pkt.seq;
+            ev->status = pkt.status;
+            ev->len = (uint16_t)pkt.payload.size();
+            std::copy(pkt.payload.begin(), pkt.payload.end(), ev->data.begin());
+            events.Publish();
+            published = true;
+        }
+        if (published) ui.Ring();
+
+        if (quiet) inFlight.LoseAll(Nak);
+    }
+
+    if (rtt.count)
+        std::cerr << "RTT over " << rtt.count << " replies: min " << rtt.minMs
+                  << " ms, avg " << rtt.sumMs / rtt.count << " ms, max " << rtt.maxMs << " ms\n";
+
+    const PacketParser::Stats& st = parser.GetStats();
+    std::cerr << "Frames " << st.frames << ", corrupt " << st.corrupt
+              << ", skipped bytes " << st.skippedBytes << ", overflow bytes " << st.overflowBytes
+              << ", NAKs " << naksSent << "\n";
+}
+
+// ================= BAUD NEGOTIATION =================
+#define LINK_BAUD      115200   // the STM32 starts at this rate and falls back to it
+#define LINK_FAST_BAUD 921600   // asked for after opening unless the command line says otherwise
+
+// Sends one request and waits for the reply with its seq, skipping any other
+// frame. Returns the reply status, -1 on timeout or a failed port. The reply
+// is also stored in *reply if given, valid until parser is fed again.
+static int Transact(SerialTransport& port, PacketParser& parser, char cmd, uint8_t seq,
+                    std::span<const uint8_t> payload, int timeoutMs, PacketView* reply = nullptr)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    if (!SendPacket(port, cmd, seq, payload)) return -1;
+    Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(timeoutMs);
+    uint8_t buf[256];
+    for (;;)
+    {
+        long left = (long)std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+        if (left <= 0) return -1;
+
+        long n = port.Read(buf, sizeof(buf), (int)left);
+        if (n < 0) return -1;
+        parser.Feed(buf, (size_t)n);
+
+        PacketView v;
+        while (parser.Next(v))
+            if (v.cmd == cmd && v.seq == seq)
+            {
+                if (reply) *reply = v;
+                return v.status;
+            }
+    }
+}
+
+// Asks the STM32 for target, switches the port once it agrees and confirms
+// at the new rate. Run before the IO thread owns the port. The STM32 goes
+// back to LINK_BAUD on its own when no confirm arrives, so on failure the
+// port does too and waits that timeout out.
+bool NegotiateBaud(SerialTransport& port, uint32_t target)
+{
+    if (target == LINK_BAUD) return true;
+
+    static PacketParser parser;
+    uint8_t rate[4] = { (uint8_t)target, (uint8_t)(target >> 8), (uint8_t)(target >> 16), (uint8_t)(target >> 24) };
+    if (Transact(port, parser, CMD_BAUD, 1, rate, 300) != STATUS_OK) return false;
+
+    if (port.SetBaud(target))
+    {
+        // The STM32 switches as soon as its reply has left the shift register
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        for (uint8_t seq = 2; seq < 5; seq++)
+            if (Transact(port, parser, CMD_BAUD, seq, {}, 100) == STATUS_OK) return true;
+    }
+
+    port.SetBaud(LINK_BAUD);
+    std::this_thread::sleep_for(std::chrono::milliseconds(600));
+    return false;
+}
+
+// ================= CONNECTION =================
+// Ports are probed with a LINK handshake at LINK_BAUD. A probe is retried
+// because an STM32 still on a faster rate from the last connection only
+// falls back to LINK_BAUD after the first probe garbles its receiver.
+#define LINK_PROBE_MS       50
+#define LINK_PROBE_TRIES    3
+#define RECONNECT_MIN_MS    10      // backoff between failed connects, doubled up to
+#define RECONNECT_MAX_MS    1000    // ... this
+
+struct LinkOptions
+{
+    std::string port;                   // empty: probe every port SerialTransport::List finds
+    uint32_t baud = LINK_FAST_BAUD;     // negotiated once the STM32 answers
+};
+
+// Where the last connection ended up, tried first on the next one
+struct LinkEndpoint
+{
+    std::string port;
+    uint32_t baud = 0;
+};
+
+// True if the STM32 answers LINK on port at its current rate
+static bool Handshake(SerialTransport& port, uint8_t seq)
+{
+    std::unique_ptr<PacketParser> parser = std::make_unique<PacketParser>();
+    PacketView reply;
+    return Transact(port, *parser, CMD_LINK, seq, {}, LINK_PROBE_MS, &reply) == STATUS_OK &&
+           std::equal(reply.payload.begin(), reply.payload.end(), linkId.begin(), linkId.end());
 }
 
-bool ReceivePacket(HANDLE h, char& cmd, uint8_t& status, std::vector<uint8_t>& payload)
+// Opens every candidate at once and keeps the first that answers LINK, so a
+// port that stays silent costs no more than the fastest answer. Once there
+// is a winner the other probes stop before their next handshake, and all of
+// them are joined before returning: no probe still holds a port that the
+// chosen one, or the next Discover, would have to share.
+static std::unique_ptr<SerialTransport> Discover(const std::vector<std::string>& ports, std::string& found)
 {
-    DWORD r;
-    uint8_t header[3];
-    if (!ReadFile(h, header, 3, &r, nullptr) || r != 3)
-        return false;
+    std::mutex m;
+    std::unique_ptr<SerialTransport> winner;
+    std::atomic<bool> decided{ false };
+
+    std::vector<std::thread> probes;
+    probes.reserve(ports.size());
+    for (const std::string& name : ports)
+        probes.emplace_back([&, name]()
+        {
+            SerialConfig cfg;
+            cfg.baud = LINK_BAUD;
+            std::unique_ptr<SerialTransport> port = SerialTransport::Open(name, cfg);
+            bool ok = false;
+            for (uint8_t seq = 1; port && !ok && !decided.load() && seq <= LINK_PROBE_TRIES; seq++)
+                ok = Handshake(*port, seq);
+            if (!ok) return;    // closes the port
 
-    cmd = header[0];
-    status = header[1];
-    uint8_t len = header[2];
+            std::lock_guard<std::mutex> lock(m);
+            if (winner) return;
+            winner = std::move(port);
+            found = name;
+            decided = true;
+        });
 
-    std::vector<uint8_t> data(len + 1);
-    if (!ReadFile(h, data.data(), len + 1, &r, nullptr) || r != len + 1)
-        return false;
+    for (std::thread& t : probes) t.join();
+    return winner;
+}
 
-    std::vector<uint8_t> chk = { (uint8_t)cmd, status, len };
-    chk.insert(chk.end(), data.begin(), data.end() - 1);
+// Finds the STM32 and brings the link up to opt.baud. After a cable blip the
+// port usually comes back under the same name with the STM32 still on the
+// negotiated rate, so that is tried first and costs one handshake.
+std::unique_ptr<SerialTransport> Connect(const LinkOptions& opt, LinkEndpoint& last)
+{
+    if (!last.port.empty())
+    {
+        SerialConfig cfg;
+        cfg.baud = last.baud;
+        std::unique_ptr<SerialTransport> port = SerialTransport::Open(last.port, cfg);
+        if (port && Handshake(*port, 1)) return port;
+    }
 
-    if (XOR_Checksum(chk) != data.back())
-        return false;
+    std::vector<std::string> ports = opt.port.empty() ? SerialTransport::List() : std::vector<std::string>{ opt.port };
+    std::string found;
+    std::unique_ptr<SerialTransport> port = Discover(ports, found);
+    if (!port) return nullptr;
 
-    payload.assign(data.begin(), data.begin() + len);
-    Sleep(5);
-    return true;
+    last.port = found;
+    last.baud = opt.baud;
+    if (!NegotiateBaud(*port, opt.baud))
+    {
+        std::cerr << "STM32 refused " << opt.baud << " baud, staying at " << LINK_BAUD << "\n";
+        last.baud = LINK_BAUD;
+    }
+    return port;
 }
 
-// ================= SERIAL HEALTH CHECK =================
-bool IsSerialAlive(HANDLE h)
+// The port the IO thread is using right now, so the UI thread can wake it.
+// Cleared before a port is closed, so Wake never touches a dead one.
+class LinkWaker
+{
+    std::mutex m;
+    SerialTransport* port = nullptr;
+
+public:
+    void Attach(SerialTransport* p)
+    {
+        std::lock_guard<std::mutex> lock(m);
+        port = p;
+    }
+
+    void Wake()
+    {
+        std::lock_guard<std::mutex> lock(m);
+        if (port) port->Wake();
+    }
+};
+
+// Owns the connection for the life of the program: finds the STM32, runs
+// the link until it fails, then looks again with backoff. The UI gets
+// EVT_LINK_UP / EVT_LINK_LOST around every connection and resyncs the game
+// with a STATE request. Requests queued while disconnected wait for the next
+// connection.
+void SerialThread(LinkOptions opt, RequestQueue& requests, EventQueue& events, LinkWaker& waker, Doorbell& ui,
+                  std::atomic<bool>& running)
 {
-    DWORD errors;
-    COMSTAT stat;
-    if (!ClearCommError(h, &errors, &stat))
-        return false;
+    LinkEndpoint last;
+    int backoffMs = 0;
+
+    while (running.load(std::memory_order_relaxed))
+    {
+        std::unique_ptr<SerialTransport> port = Connect(opt, last);
+        if (!port)
+        {
+            backoffMs = std::clamp(backoffMs * 2, RECONNECT_MIN_MS, RECONNECT_MAX_MS);
+            for (int ms = 0; ms < backoffMs && running.load(std::memory_order_relaxed); ms += 10)
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            continue;
+        }
+        backoffMs = 0;
 
-    return true;
+        waker.Attach(port.get());
+        PublishLinkEvent(events, ui, EVT_LINK_UP, running);
+        RunLink(*port, requests, events, ui, running);
+        waker.Attach(nullptr);
+
+        if (running.load(std::memory_order_relaxed))
+            PublishLinkEvent(events, ui, EVT_LINK_LOST, running);
+    }
 }
 
+// ================= CLICK BENCHMARK =================
+// Clicks per second at several pipelining depths on hard games. The MINEFIELD
+// reply holds the whole board, mines included, so only safe cells are clicked,
+// in random order and skipping those already seen open. Once every safe cell
+// has been clicked a new game is requested and clicking waits for its board.
+int RunClickBench(SerialTransport& port)
+{
+    static PacketParser parser;
+    const int clicks = 2000;
+    uint8_t buf[512];
+    uint8_t seq = 0;
+    std::mt19937 rng(1);
+
+    int size = 0;
+    std::vector<uint8_t> open;
+    std::vector<int> safe;              // cells left to click, shuffled
+    size_t next = 0;
+    bool waiting = false;               // for a MINEFIELD reply
+    int inFlight = 0, played = 0, errors = 0, games = 0;
+
+    auto NextSeq = [&]() { if (++seq == 0) seq = 1; return seq; };
+
+    auto NewGame = [&]() -> bool
+    {
+        uint8_t diff = DIFF_HARD;
+        if (!SendPacket(port, CMD_MINEFIELD, NextSeq(), { &diff, 1 })) return false;
+        inFlight++;
+        waiting = true;
+        return true;
+    };
+
+    // Reads once and handles the replies (frames with a seq) that came in
+    auto Pump = [&]() -> bool
+    {
+        long n = port.Read(buf, sizeof(buf), 1000);
+        if (n <= 0) return false;
+        parser.Feed(buf, (size_t)n);
+        PacketView v;
+        while (parser.Next(v))
+        {
+            if (v.seq == 0) continue;
+            inFlight--;
+            if (v.cmd == CMD_MINEFIELD)
+            {
+                if (v.status != STATUS_OK) { std::cerr << "MINEFIELD refused\n"; return false; }
+                size = int(std::sqrt(v.payload.size()));
+                open.assign(size * size, 0);
+                safe.clear();
+                for (int i = 0; i < size * size; i++)
+                    if (v.payload[i] != CELL_MINE) safe.push_back(i);
+                std::shuffle(safe.begin(), safe.end(), rng);
+                next = 0;
+                waiting = false;
+            }
+            else if (v.cmd == CMD_CLICK)
+            {
+                // A click still in flight when another one wins the game
+                // gets STATUS_ERR
+                if (v.status == STATUS_ERR) { errors++; continue; }
+                played++;
+                for (size_t i = 0; i + 2 < v.payload.size(); i += 3)
+                    if (v.payload[i] < size && v.payload[i + 1] < size)
+                        open[v.payload[i] * size + v.payload[i + 1]] = 1;
+                if (v.status != STATUS_OK) games++;
+            }
+        }
+        return true;
+    };
+
+    for (int depth : { 1, 4, 16 })
+    {
+        // The clock starts with the first board in hand
+        if (!NewGame()) return 1;
+        while (waiting)
+            if (!Pump()) { std::cerr << "No reply to MINEFIELD\n"; return 1; }
+
+        auto t0 = std::chrono::steady_clock::now();
+        int sent = 0;
+        played = errors = games = 0;
+        while (sent < clicks || inFlight > 0)
+        {
+            while (sent < clicks && inFlight < depth && !waiting)
+            {
+                while (next < safe.size() && open[safe[next]]) next++;
+                if (next == safe.size()) { if (!NewGame()) return 1; break; }
+                int cell = safe[next++];
+                uint8_t rc[2] = { (uint8_t)(cell / size), (uint8_t)(cell % size) };
+                if (!SendPacket(port, CMD_CLICK, NextSeq(), rc)) return 1;
+                sent++;
+                inFlight++;
+            }
+            if (!Pump()) { std::cerr << "Stopped at depth " << depth << "\n"; return 1; }
+        }
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+        std::cout << "depth " << depth << ": " << int(played / secs) << " clicks/s, "
+                  << secs * 1000.0 / played << " ms per click, " << games << " games won, "
+                  << errors << " clicks after a win\n";
+    }
+    return 0;
+}
+
+// ================= LINK BENCHMARK =================
+// ECHO frames with payloads of random size in [minSize, maxSize], sent at a
+// fixed rate or as fast as the window allows. Every echoed byte is checked.
+struct LinkBenchConfig
+{
+    int count = 2000;
+    double rate = 0;            // frames per second, 0 for back to back
+    int minSize = 1;
+    int maxSize = ECHO_MAX_PAYLOAD;
+};
+
+// Request bytes allowed in flight; the STM32 RX ring is 512 bytes and stops
+// being drained while an ECHO reply is rendered
+#define LINK_BENCH_WINDOW  384
+#define LINK_BENCH_TIMEOUT 500     // ms before a missing reply counts as lost
+
+int RunLinkBench(SerialTransport& port, const LinkBenchConfig& cfg, uint32_t baud)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    struct Pending
+    {
+        bool used = false;
+        uint16_t size = 0;
+        uint32_t frame = 0;     // seeds the payload pattern
+        Clock::time_point sentAt;
+    };
+
+    static PacketParser parser;
+    Pending pending[256];
+    std::vector<double> rttMs;
+    rttMs.reserve(cfg.count);
+    std::mt19937 rng(12345);
+    std::uniform_int_distribution<int> sizeDist(cfg.minSize, cfg.maxSize);
+    auto Pattern = [](uint32_t frame, size_t i) { return (uint8_t)(frame * 37 + i * 11); };
+
+    uint8_t frameBuf[MAX_ECHO_FRAME];
+    uint8_t payload[ECHO_MAX_PAYLOAD];
+    uint8_t buf[1024];
+    uint8_t seq = 0;
+    int sent = 0, done = 0, lost = 0, bad = 0;
+    size_t inFlight = 0, inFlightBytes = 0;
+    uint64_t goodBytes = 0;
+
+    Clock::time_point t0 = Clock::now();
+    while (done < cfg.count)
+    {
+        Clock::time_point now = Clock::now();
+
+        // Send whatever the schedule and the window allow
+        while (sent < cfg.count)
+        {
+            if (cfg.rate > 0 && now < t0 + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(sent / cfg.rate)))
+                break;
+
+            int size = sizeDist(rng);
+            if (inFlight == 255 || inFlightBytes + size + TX_HEADER_SIZE + FRAME_CRC_SIZE > LINK_BENCH_WINDOW)
+                break;
+
+            do if (++seq == 0) seq = 1; while (pending[seq].used);
+            for (int i = 0; i < size; i++) payload[i] = Pattern(sent, i);
+            size_t n = EncodePacket(frameBuf, CMD_ECHO, seq, { payload, (size_t)size });
+            if (!port.Write(frameBuf, n)) { std::cerr << "Write failed\n"; return 1; }
+
+            pending[seq] = { true, (uint16_t)size, (uint32_t)sent, Clock::now() };
+            inFlight++;
+            inFlightBytes += n;
+            sent++;
+        }
+
+        long n = port.Read(buf, sizeof(buf), cfg.rate > 0 ? 1 : 10);
+        if (n < 0) { std::cerr << "Read failed\n"; return 1; }
+        parser.Feed(buf, (size_t)n);
+        now = Clock::now();
+
+        PacketView v;
+        while (parser.Next(v))
+        {
+            Pending& p = pending[v.seq];
+            if (v.cmd != CMD_ECHO || !p.used) continue;
+
+            bool ok = v.status == STATUS_OK && v.payload.size() == p.size;
+            for (size_t i = 0; ok && i < p.size; i++)
+                ok = v.payload[i] == Pattern(p.frame, i);
+
+            if (ok)
+            {
+                rttMs.push_back(std::chrono::duration<double, std::milli>(now - p.sentAt).count());
+                goodBytes += p.size;
+            }
+            else bad++;
+
+            p.used = false;
+            inFlight--;
+            inFlightBytes -= p.size + TX_HEADER_SIZE + FRAME_CRC_SIZE;
+            done++;
+        }
+
+        // Replies lost to a corrupt frame never come
+        for (Pending& p : pending)
+            if (p.used && now - p.sentAt > std::chrono::milliseconds(LINK_BENCH_TIMEOUT))
+            {
+                p.used = false;
+                inFlight--;
+                inFlightBytes -= p.size + TX_HEADER_SIZE + FRAME_CRC_SIZE;
+                lost++;
+                done++;
+            }
+    }
+    double secs = std::chrono::duration<double>(Clock::now() - t0).count();
+
+    std::sort(rttMs.begin(), rttMs.end());
+    auto Percentile = [&](double q) { return rttMs.empty() ? 0.0 : rttMs[size_t(q * (rttMs.size() - 1))]; };
+    double goodput = goodBytes / secs;
+
+    std::cout << cfg.count << " ECHO frames of " << cfg.minSize << ".." << cfg.maxSize << " bytes at " << baud << " baud in "
+              << secs << " s\n"
+              << "RTT ms: p50 " << Percentile(0.5) << ", p90 " << Percentile(0.9) << ", p99 " << Percentile(0.99)
+              << ", max " << Percentile(1.0) << "\n"
+              << "Goodput " << int(goodput) << " B/s each way, " << 100.0 * goodput * 10 / baud << "% of the line\n"
+              << "Errors: " << lost << " lost, " << bad << " bad, " << parser.GetStats().corrupt << " corrupt frames ("
+              << 100.0 * (lost + bad) / cfg.count << "% of requests)\n";
+    return lost + bad ? 2 : 0;
+}
+
+// ================= UI LOOP =================
+// The window is redrawn only after input, serial events (timer ticks
+// included) or IDLE_REFRESH_MS without either. SFML 2 can not wait on window
+// events and the IO thread at once, so between frames the UI thread sleeps on
+// the Doorbell and looks for input every INPUT_POLL_MS.
+#define INPUT_POLL_MS       10
+#define IDLE_REFRESH_MS     1000    // in case the window lost its contents
+#define LOOP_STATS_PERIOD   5       // seconds between --loop-stats reports
+
+struct LoopStats
+{
+    typedef std::chrono::steady_clock Clock;
+
+    Clock::time_point since = Clock::now();
+    Clock::duration idle{};         // spent asleep on the Doorbell
+    uint64_t frames = 0;
+    uint64_t wakeups = 0;
+
+    double Seconds() const { return std::chrono::duration<double>(Clock::now() - since).count(); }
+    double IdlePercent() const { return 100.0 * std::chrono::duration<double>(idle).count() / Seconds(); }
+
+    void Print(const char* what) const
+    {
+        double secs = Seconds();
+        std::cerr << what << ": " << frames / secs << " frames/s, " << wakeups / secs << " wakeups/s, UI thread idle "
+                  << IdlePercent() << "%\n";
+    }
+};
+
 // ================= MAIN =================
-int main()
+// Usage: Minesweeper [--bench-clicks] [--loop-stats] [port [baud]]
+//        Minesweeper --bench-link [--count=N] [--rate=FPS] [--size=MIN[-MAX]]
+//                    [--simulate [--sim-corrupt=P]] [port [baud]]
+// The port always opens at LINK_BAUD; baud is the rate negotiated afterwards.
+// Without a port, or with "auto", every port SerialTransport::List finds is
+// probed for the STM32.
+// --simulate runs the link against LinkSimulator on a pty, which takes the
+// place of port, so the only argument left is baud.
+// --loop-stats reports frames drawn and how idle the UI thread was every
+// LOOP_STATS_PERIOD seconds and over the whole run at exit, and how long
+// the images and the first frame took after start.
+int main(int argc, char** argv)
 {
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point startedAt = Clock::now();
+
+    std::vector<std::string> args;
+    bool benchClicks = false;
+    bool loopStats = false;
+    bool benchLink = false;
+    bool simulate = false;
+    LinkBenchConfig linkCfg;
+    SimulatorConfig simCfg;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string a = argv[i];
+        std::string value = a.find('=') != std::string::npos ? a.substr(a.find('=') + 1) : std::string();
+
+        if (a == "--bench-clicks") benchClicks = true;
+        else if (a == "--loop-stats") loopStats = true;
+        else if (a == "--bench-link") benchLink = true;
+        else if (a == "--simulate") simulate = true;
+        else if (a.rfind("--count=", 0) == 0) linkCfg.count = std::stoi(value);
+        else if (a.rfind("--rate=", 0) == 0) linkCfg.rate = std::stod(value);
+        else if (a.rfind("--sim-corrupt=", 0) == 0) simCfg.corruptRate = std::stod(value);
+        else if (a.rfind("--size=", 0) == 0)
+        {
+            size_t dash = value.find('-');
+            linkCfg.minSize = std::stoi(value.substr(0, dash));
+            linkCfg.maxSize = dash == std::string::npos ? linkCfg.minSize : std::stoi(value.substr(dash + 1));
+            linkCfg.minSize = std::clamp(linkCfg.minSize, 1, ECHO_MAX_PAYLOAD);
+            linkCfg.maxSize = std::clamp(linkCfg.maxSize, linkCfg.minSize, ECHO_MAX_PAYLOAD);
+        }
+        else args.push_back(a);
+    }
+    if (simulate) args.insert(args.begin(), std::string());
+
+    LinkOptions linkOpt;
+    if (args.size() > 0 && args[0] != "auto") linkOpt.port = args[0];
+    if (args.size() > 1) linkOpt.baud = (uint32_t)std::stoul(args[1]);
+
+    if (simulate)
+    {
+#ifdef _WIN32
+        std::cerr << "--simulate needs a POSIX pty\n";
+        return 1;
+#else
+        linkOpt.port = StartLinkSimulator(simCfg);
+        if (linkOpt.port.empty())
+        {
+            std::cerr << "Cannot start the link simulator\n";
+            return 1;
+        }
+#endif
+    }
+
+    if (benchLink || benchClicks)
+    {
+        LinkEndpoint ep;
+        std::unique_ptr<SerialTransport> port = Connect(linkOpt, ep);
+        if (!port)
+        {
+            std::cerr << "No STM32 answered on " << (linkOpt.port.empty() ? "any port" : linkOpt.port) << "\n";
+            return 1;
+        }
+        std::cerr << "STM32 on " << ep.port << " at " << ep.baud << " baud\n";
+        return benchLink ? RunLinkBench(*port, linkCfg, ep.baud) : RunClickBench(*port);
+    }
+
+#ifdef _WIN32
     ShowWindow(GetConsoleWindow(), SW_HIDE);
+#endif
 
     sf::RenderWindow window(sf::VideoMode(800, 600), "Minesweeper");
     window.setFramerateLimit(60);
 
-    State state = State::MAIN_MENU;
-
-    // ========== MENU TEXTURES ==========
-    sf::Texture bgTex, playTex, exitTex;
-    sf::Texture easyTex, medTex, hardTex;
-    sf::Texture resetTex, backTex, errorTex;
-
-    bgTex.loadFromFile("menu.png");
-    playTex.loadFromFile("play.png");
-    exitTex.loadFromFile("exit.png");
-    easyTex.loadFromFile("easy.png");
-    medTex.loadFromFile("medium.png");
-    hardTex.loadFromFile("hard.png");
-    resetTex.loadFromFile("reset.png");
-    backTex.loadFromFile("back.png");
-    errorTex.loadFromFile("error.png");
-
-    sf::Sprite bg(bgTex), play(playTex), exitBtn(exitTex);
-    sf::Sprite easy(easyTex), med(medTex), hard(hardTex);
-    sf::Sprite resetBtn(resetTex), backBtn(backTex);
-    sf::Sprite errorSprite(errorTex);
-
-    bg.setScale(800.f / bgTex.getSize().x, 600.f / bgTex.getSize().y);
+    // Shows the error screen until the IO thread finds the STM32
+    State state = State::EROR;
+    State resumeState = State::MAIN_MENU;   // where to go back to once it is found
+
+    // ========== TEXTURES ==========
+    // Every image in one texture, from the packed bundle when there is one.
+    // Otherwise the PNGs decode in the background and the first frame waits
+    // only for the error screen it shows and the main menu that follows.
+    Clock::time_point assetsFrom = Clock::now();
+    const std::vector<std::string> startupImages = { "error.png", "menu.png", "play.png", "exit.png" };
+    AssetAtlas assets;
+    assets.Load(startupImages);
+    assets.WaitFor(startupImages);
+
+    bool assetsLogged = false;
+    auto LogAssets = [&]()
+    {
+        if (!loopStats || assetsLogged || !assets.Done()) return;
+        assetsLogged = true;
+        std::cerr << "Assets: " << assets.Count() << " images from " << (assets.FromBundle() ? ASSET_BUNDLE : "PNG files")
+                  << " in " << std::chrono::duration<double, std::milli>(Clock::now() - assetsFrom).count() << " ms\n";
+    };
+    LogAssets();
+
+    // ========== MENU SPRITES ==========
+    sf::Sprite bg = assets.Sprite("menu.png"), play = assets.Sprite("play.png"), exitBtn = assets.Sprite("exit.png");
+    sf::Sprite easy = assets.Sprite("easy.png"), med = assets.Sprite("medium.png"), hard = assets.Sprite("hard.png");
+    sf::Sprite resetBtn = assets.Sprite("reset.png"), backBtn = assets.Sprite("back.png");
+    sf::Sprite errorSprite = assets.Sprite("error.png");
+
+    bg.setScale(800.f / bg.getTextureRect().width, 600.f / bg.getTextureRect().height);
     play.setPosition(330, 200);
     exitBtn.setPosition(330, 320);
 
@@ -146,51 +953,99 @@ int main()
     backBtn.setPosition(330, 440);
 
     errorSprite.setPosition(
-        (800 - errorTex.getSize().x) / 2.f,
-        (600 - errorTex.getSize().y) / 2.f
+        (800 - errorSprite.getTextureRect().width) / 2.f,
+        (600 - errorSprite.getTextureRect().height) / 2.f
     );
 
-    // ========== CELL TEXTURES ==========
-    sf::Texture numbers[9], closedTex, mineTex, flagTex, winTex, loseTex;
-    for (int i = 0; i <= 8; i++)
-        numbers[i].loadFromFile(std::to_string(i) + ".png");
+    // ========== BOARD ==========
+    BoardView board;
+    board.SetAtlas(assets);
 
-    closedTex.loadFromFile("closed.png");
-    mineTex.loadFromFile("mine.png");
-    flagTex.loadFromFile("flag.png");
-    winTex.loadFromFile("WIN.png");
-    loseTex.loadFromFile("NOWIN.png");
+    // The HARD board's square, clear of the timer; bigger boards shrink into it
+    const sf::FloatRect boardArea(212.5f, 112.5f, 375.f, 375.f);
+    const float maxCell = 25.f;
 
-    sf::Sprite cell, endGameSprite;
+    sf::Sprite endGameSprite;
 
     // ========== TIMER ==========
-    sf::Texture timerDigits[10], colonTex;
+    sf::IntRect timerDigits[10];
     for (int i = 0; i <= 9; i++)
-        timerDigits[i].loadFromFile("(" + std::to_string(i) + ").png");
-    colonTex.loadFromFile("colon.png");
+        timerDigits[i] = assets.Rect("(" + std::to_string(i) + ").png");
 
-    sf::Sprite timerSprites[4], colonSprite;
-    colonSprite.setTexture(colonTex);
+    sf::Sprite timerSprites[4], colonSprite = assets.Sprite("colon.png");
+    for (sf::Sprite& d : timerSprites)
+        d.setTexture(assets.GetTexture());
 
     // ========== SERIAL ==========
-    HANDLE hSerial = OpenSerial("\\\\.\\COM10");
-    if (!hSerial)
+    static RequestQueue requests;
+    static EventQueue events;      // 128 KB of fixed-size events
+    static LinkWaker waker;
+    static Doorbell uiBell;
+    std::atomic<bool> ioRunning{ true };
+    std::thread ioThread(SerialThread, linkOpt, std::ref(requests), std::ref(events), std::ref(waker), std::ref(uiBell),
+                         std::ref(ioRunning));
+
+    // Requests the full queue turned away, e.g. while the link is down. They
+    // go out first and in order as the IO thread frees slots, so a STATE or
+    // MINEFIELD is never lost and nothing overtakes a FLAG.
+    std::deque<SerialRequest> unsent;
+    auto FlushUnsent = [&]()
     {
-        state = State::EROR;
-    }
+        while (!unsent.empty() && requests.Push(std::move(unsent.front())))
+            unsent.pop_front();
+    };
+
+    auto Send = [&](char cmd, std::initializer_list<uint8_t> payload)
+    {
+        SerialRequest rq;
+        rq.cmd = cmd;
+        rq.len = (uint8_t)payload.size();
+        std::copy(payload.begin(), payload.end(), rq.data.begin());
+        FlushUnsent();
+        if (!unsent.empty() || !requests.Push(std::move(rq))) unsent.push_back(rq);
+        waker.Wake();
+    };
 
     std::vector<uint8_t> displayField;
     int fieldSize = 0;
-    const float cellSize = 25.f;
     bool gameEnded = false;
     int timerSec = 0;
     char currentDiff = 0;
 
+    // Shows the end screen for a LOSE or WIN status
+    auto EndGame = [&](uint8_t st)
+    {
+        if (st != STATUS_LOSE && st != STATUS_WIN) return;
+        gameEnded = true;
+        endGameSprite = assets.Sprite(st == STATUS_LOSE ? "NOWIN.png" : "WIN.png");
+        endGameSprite.setPosition(
+            (800 - endGameSprite.getTextureRect().width) / 2.f,
+            (600 - endGameSprite.getTextureRect().height) / 2.f);
+    };
+
+    LoopStats total, period;
+    bool redraw = true;
+    sf::Clock sinceDraw;
+
+    // Startup ends with the first frame on screen
+    bool shownFirst = false;
+    auto Present = [&]()
+    {
+        window.display();
+        if (!loopStats || shownFirst) return;
+        shownFirst = true;
+        std::cerr << "First frame " << std::chrono::duration<double, std::milli>(Clock::now() - startedAt).count()
+                  << " ms after start\n";
+    };
+
     while (window.isOpen())
     {
         sf::Event e;
         while (window.pollEvent(e))
         {
+            // Nothing on screen follows the pointer
+            if (e.type != sf::Event::MouseMoved) redraw = true;
+
             if (e.type == sf::Event::Closed)
                 window.close();
 
@@ -204,41 +1059,13 @@ int main()
                 e.type == sf::Event::MouseButtonPressed &&
                 e.mouseButton.button == sf::Mouse::Left)
             {
-                float sx = (800 - fieldSize * cellSize) / 2.f;
-                float sy = (600 - fieldSize * cellSize) / 2.f;
-                int col = int((mouse.x - sx) / cellSize);
-                int row = int((mouse.y - sy) / cellSize);
-
-                if (row >= 0 && col >= 0 && row < fieldSize && col < fieldSize)
+                int row, col;
+                if (board.CellAt(mouse, row, col))
                 {
                     int idx = row * fieldSize + col;
                     if (displayField[idx] == CELL_FLAG) continue;
 
-                    SendPacket(hSerial, CMD_CLICK, { (uint8_t)row,(uint8_t)col });
-
-                    char rc; uint8_t st; std::vector<uint8_t> r;
-                    if (ReceivePacket(hSerial, rc, st, r))
-                    {
-                        for (size_t i = 0; i < r.size(); i += 3)
-                            displayField[r[i] * fieldSize + r[i + 1]] = r[i + 2];
-
-                        if (st == STATUS_LOSE)
-                        {
-                            gameEnded = true;
-                            endGameSprite.setTexture(loseTex);
-                        }
-                        else if (st == STATUS_WIN)
-                        {
-                            gameEnded = true;
-                            endGameSprite.setTexture(winTex);
-                        }
-
-                        if (gameEnded)
-                            endGameSprite.setPosition(
-                                (800 - endGameSprite.getTexture()->getSize().x) / 2.f,
-                                (600 - endGameSprite.getTexture()->getSize().y) / 2.f);
-                    }
-                    else state = State::EROR;
+                    Send(CMD_CLICK, { (uint8_t)row,(uint8_t)col });
                 }
             }
 
@@ -247,16 +1074,16 @@ int main()
                 e.type == sf::Event::MouseButtonPressed &&
                 e.mouseButton.button == sf::Mouse::Right)
             {
-                float sx = (800 - fieldSize * cellSize) / 2.f;
-                float sy = (600 - fieldSize * cellSize) / 2.f;
-                int col = int((mouse.x - sx) / cellSize);
-                int row = int((mouse.y - sy) / cellSize);
-
-                if (row >= 0 && col >= 0 && row < fieldSize && col < fieldSize)
+                int row, col;
+                if (board.CellAt(mouse, row, col))
                 {
                     int idx = row * fieldSize + col;
-                    if (displayField[idx] == CELL_CLOSED) displayField[idx] = CELL_FLAG;
-                    else if (displayField[idx] == CELL_FLAG) displayField[idx] = CELL_CLOSED;
+                    if (displayField[idx] == CELL_CLOSED || displayField[idx] == CELL_FLAG)
+                    {
+                        displayField[idx] = (displayField[idx] == CELL_FLAG) ? CELL_CLOSED : CELL_FLAG;
+                        board.SetCell(row, col, displayField[idx]);
+                        Send(CMD_FLAG, { (uint8_t)row,(uint8_t)col });
+                    }
                 }
             }
 
@@ -267,22 +1094,13 @@ int main()
                 // RESET
                 if (resetBtn.getGlobalBounds().contains(mouse))
                 {
-                    SendPacket(hSerial, CMD_MINEFIELD, { (uint8_t)currentDiff });
-                    char rc; uint8_t st; std::vector<uint8_t> field;
-                    if (ReceivePacket(hSerial, rc, st, field))
-                    {
-                        fieldSize = int(std::sqrt(field.size()));
-                        displayField.assign(fieldSize * fieldSize, CELL_CLOSED);
-                        gameEnded = false;
-                        timerSec = 0;
-                    }
-                    else state = State::EROR;
+                    Send(CMD_MINEFIELD, { (uint8_t)currentDiff });
                 }
 
                 // BACK TO MENU
                 if (backBtn.getGlobalBounds().contains(mouse))
                 {
-                    SendPacket(hSerial, CMD_ABORT, {});
+                    Send(CMD_ABORT, {});
                     state = State::MAIN_MENU;
                     gameEnded = false;
                     currentDiff = 0;
@@ -314,52 +1132,133 @@ int main()
 
                     if (diff)
                     {
-                        SendPacket(hSerial, CMD_MINEFIELD, { (uint8_t)diff });
-                        char rc; uint8_t st; std::vector<uint8_t> field;
-                        if (ReceivePacket(hSerial, rc, st, field))
-                        {
-                            fieldSize = int(std::sqrt(field.size()));
-                            displayField.assign(fieldSize * fieldSize, CELL_CLOSED);
-                            state = State::GAME;
-                            gameEnded = false;
-                            timerSec = 0;
-                            currentDiff = diff;
-                        }
-                        else state = State::EROR;
+                        Send(CMD_MINEFIELD, { (uint8_t)diff });
+                        currentDiff = diff;
                     }
                 }
             }
         }
 
-        // ===== TIMER UART =====
-        if (!IsSerialAlive(hSerial))
-        {
-            state = State::EROR;
-        }
-        else
+        // ===== SERIAL EVENTS =====
+        while (const SerialEvent* ev = events.Peek())
         {
-            char ch;
-            DWORD r;
-            while (ReadFile(hSerial, &ch, 1, &r, nullptr) && r == 1)
+            std::span<const uint8_t> r = ev->Payload();
+            redraw = true;
+
+            if (ev->cmd == EVT_LINK_LOST)
             {
-                if (ch == 'T')
-                {
-                    std::string s;
-                    while (ReadFile(hSerial, &ch, 1, &r, nullptr) && r == 1 && ch != '\n')
-                        s += ch;
-                    try { timerSec = std::stoi(s); }
-                    catch (...) {}
-                }
+                if (state != State::EROR) resumeState = state;
+                state = State::EROR;
+            }
+            else if (ev->cmd == EVT_LINK_UP)
+            {
+                // Whatever happened to the game meanwhile, the STM32 knows
+                state = resumeState;
+                if (state == State::GAME) Send(CMD_STATE, {});
+            }
+            else if (ev->cmd == CMD_TIMER)
+            {
+                if (r.size() == 2)
+                    timerSec = r[0] | (r[1] << 8);
+            }
+
+            // A refused MINEFIELD leaves the menu as it was
+            if (ev->cmd == CMD_MINEFIELD && state != State::EROR && ev->status == STATUS_OK)
+            {
+                fieldSize = int(std::sqrt(r.size()));
+                displayField.assign(fieldSize * fieldSize, CELL_CLOSED);
+                board.SetBoard(displayField, fieldSize, boardArea, maxCell);
+                state = State::GAME;
+                gameEnded = false;
+                timerSec = 0;
+            }
+
+            // Replies to clicks sent after the game ended carry an error status
+            if (ev->cmd == CMD_CLICK && state == State::GAME && !gameEnded &&
+                (ev->status == STATUS_OK || ev->status == STATUS_LOSE || ev->status == STATUS_WIN))
+            {
+                // Only cells opened by this click are sent, apply them on top
+                for (size_t i = 0; i + 2 < r.size(); i += 3)
+                    if (r[i] < fieldSize && r[i + 1] < fieldSize)
+                    {
+                        displayField[r[i] * fieldSize + r[i + 1]] = r[i + 2];
+                        board.SetCell(r[i], r[i + 1], r[i + 2]);
+                    }
+
+                EndGame(ev->status);
             }
+
+            // A lost reply, or a reconnect, brings the whole board; its cell
+            // codes match CELL_CLOSED and CELL_FLAG. An empty STATE means the
+            // game is gone, e.g. the STM32 was reset.
+            int snapSize = int(std::sqrt(r.size()));
+            bool snapshot = ev->cmd == CMD_NAK || ev->cmd == CMD_STATE;
+            if (ev->cmd == CMD_STATE && r.empty() && state == State::GAME)
+            {
+                state = State::MAIN_MENU;
+                gameEnded = false;
+                currentDiff = 0;
+            }
+            else if (snapshot && snapSize > 0 && size_t(snapSize * snapSize) == r.size() &&
+                (state == State::GAME || state == State::DIFFICULTY_MENU))
+            {
+                fieldSize = snapSize;
+                displayField.assign(r.begin(), r.end());
+                board.SetBoard(displayField, fieldSize, boardArea, maxCell);
+                state = State::GAME;
+                gameEnded = false;
+                EndGame(ev->status);
+            }
+
+            events.Release();
         }
 
+        if (!unsent.empty())
+        {
+            FlushUnsent();
+            waker.Wake();
+        }
+
+        // ===== ASSETS =====
+        // The rest of the images, uploaded as they finish decoding. Cells
+        // already on the board surface were drawn from the atlas as it was.
+        if (assets.Poll())
+        {
+            board.Redraw();
+            redraw = true;
+            LogAssets();
+        }
+
+        if (loopStats && period.Seconds() >= LOOP_STATS_PERIOD)
+        {
+            period.Print("UI");
+            period = LoopStats();
+        }
+
+        // ===== IDLE =====
+        if (!redraw && sinceDraw.getElapsedTime() < sf::milliseconds(IDLE_REFRESH_MS))
+        {
+            LoopStats::Clock::time_point t = LoopStats::Clock::now();
+            uiBell.Wait(INPUT_POLL_MS);
+            LoopStats::Clock::duration slept = LoopStats::Clock::now() - t;
+            total.idle += slept;
+            period.idle += slept;
+            total.wakeups++;
+            period.wakeups++;
+            continue;
+        }
+        redraw = false;
+        sinceDraw.restart();
+        total.frames++;
+        period.frames++;
+
         // ===== DRAW =====
         window.clear();
 
         if (state == State::EROR)
         {
             window.draw(errorSprite);
-            window.display();
+            Present();
             continue;
         }
 
@@ -379,20 +1278,9 @@ int main()
         }
         else if (state == State::GAME)
         {
-            float sx = (800 - fieldSize * cellSize) / 2.f;
-            float sy = (600 - fieldSize * cellSize) / 2.f;
-
-            for (int i = 0; i < fieldSize; i++)
-                for (int j = 0; j < fieldSize; j++)
-                {
-                    cell.setPosition(sx + j * cellSize, sy + i * cellSize);
-                    uint8_t v = displayField[i * fieldSize + j];
-                    if (v == CELL_CLOSED) cell.setTexture(closedTex);
-                    else if (v == CELL_FLAG) cell.setTexture(flagTex);
-                    else if (v == CELL_MINE) cell.setTexture(mineTex);
-                    else cell.setTexture(numbers[v]);
-                    window.draw(cell);
-                }
+            // Only cells changed since the last frame are drawn onto the board
+            board.Flush();
+            window.draw(board);
 
             // ===== DRAW TIMER MM:SS =====
             int m = timerSec / 60;
@@ -404,7 +1292,7 @@ int main()
             float scale = 1.f;
             for (int i = 0; i < 4; i++)
             {
-                timerSprites[i].setTexture(timerDigits[digitsArr[i]]);
+                timerSprites[i].setTextureRect(timerDigits[digitsArr[i]]);
                 timerSprites[i].setPosition(timerX + i * spacing + (i >= 2 ? 10.f : 0.f), timerY);
                 timerSprites[i].setScale(scale, scale);
                 window.draw(timerSprites[i]);
@@ -421,9 +1309,13 @@ int main()
             }
         }
 
-        window.display();
+        Present();
     }
 
-    CloseHandle(hSerial);
+    if (loopStats) total.Print("UI over the whole run");
+
+    ioRunning = false;
+    waker.Wake();
+    ioThread.join();
     return 0;
 }
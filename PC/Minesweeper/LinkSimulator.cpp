@@ -0,0 +1,275 @@
+#ifndef _WIN32
+#include "LinkSimulator.h"
+#include "Protocol.h"
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <cerrno>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+
+// Cell value of a mine, as MINE in the firmware and CELL_MINE in BoardView.h
+#define MINE 9
+
+namespace
+{
+class LinkSimulator
+{
+    typedef std::chrono::steady_clock Clock;
+
+    int master;
+    SimulatorConfig cfg;
+    uint32_t baud = 115200;
+    std::vector<uint8_t> rx;            // request bytes not decoded yet
+    Clock::time_point lineFree = Clock::now();
+    std::mt19937 rng{ 1 };
+
+    // The game, with the firmware's rules: mine counts per difficulty, a
+    // first click that never hits a mine, zero cells opening their neighbours
+    int size = 0;
+    std::vector<uint8_t> value;         // adjacent mines, MINE for a mine
+    std::vector<uint8_t> opened;
+    bool gameOver = true;
+    bool firstClick = false;
+
+    // Sends a frame once the simulated wire would have delivered its last byte
+    void Reply(uint8_t cmd, uint8_t seq, uint8_t status, std::span<const uint8_t> payload)
+    {
+        std::vector<uint8_t> f = { FRAME_SOF, cmd, seq, status,
+                                   (uint8_t)(payload.size() & 0xFF), (uint8_t)(payload.size() >> 8) };
+        f.insert(f.end(), payload.begin(), payload.end());
+        uint32_t crc = Crc32(CRC_INIT, f);
+        for (size_t i = 0; i < FRAME_CRC_SIZE; i++) f.push_back((uint8_t)(crc >> (8 * i)));
+
+        if (cfg.corruptRate > 0 && std::uniform_real_distribution<double>(0, 1)(rng) < cfg.corruptRate)
+            f[std::uniform_int_distribution<size_t>(1, f.size() - 1)(rng)] ^= 0x24;
+
+        // 8N1: ten bit times per byte
+        Clock::time_point now = Clock::now();
+        if (lineFree < now) lineFree = now;
+        lineFree += std::chrono::nanoseconds(f.size() * 10 * 1000000000ull / baud);
+        std::this_thread::sleep_until(lineFree);
+
+        for (size_t off = 0; off < f.size();)
+        {
+            ssize_t w = write(master, f.data() + off, f.size() - off);
+            if (w < 0 && errno != EINTR && errno != EAGAIN) return;
+            if (w > 0) off += (size_t)w;
+        }
+    }
+
+    void NewGame(uint8_t level)
+    {
+        int mines;
+        switch (level)
+        {
+        case DIFF_MEDIUM: size = 10; mines = 20; break;
+        case DIFF_HARD:   size = 15; mines = 30; break;
+        default:          size = 5;  mines = 5;  break;
+        }
+        value.assign(size * size, 0);
+        opened.assign(size * size, 0);
+        for (int placed = 0; placed < mines; )
+        {
+            int k = std::uniform_int_distribution<int>(0, size * size - 1)(rng);
+            if (value[k] != MINE) { value[k] = MINE; placed++; }
+        }
+        Count();
+        gameOver = false;
+        firstClick = true;
+    }
+
+    void Count()
+    {
+        for (int r = 0; r < size; r++)
+            for (int c = 0; c < size; c++)
+            {
+                if (value[r * size + c] == MINE) continue;
+                uint8_t n = 0;
+                for (int dr = -1; dr <= 1; dr++)
+                    for (int dc = -1; dc <= 1; dc++)
+                    {
+                        int rr = r + dr, cc = c + dc;
+                        if (rr >= 0 && rr < size && cc >= 0 && cc < size && value[rr * size + cc] == MINE) n++;
+                    }
+                value[r * size + c] = n;
+            }
+    }
+
+    // Opens (r, c) and the zero region around it; returns the click's
+    // status and the opened cells as (row, col, value) in row order
+    uint8_t Click(int r, int c, std::vector<uint8_t>& delta)
+    {
+        int k = r * size + c;
+        if (firstClick && value[k] == MINE)
+        {
+            int to;
+            do to = std::uniform_int_distribution<int>(0, size * size - 1)(rng);
+            while (value[to] == MINE);
+            value[to] = MINE;
+            value[k] = 0;
+            Count();
+        }
+        firstClick = false;
+
+        std::vector<uint8_t> fresh(size * size, 0);
+        std::vector<int> stack;
+        if (!opened[k]) stack.push_back(k);
+        while (!stack.empty())
+        {
+            int at = stack.back();
+            stack.pop_back();
+            if (opened[at] || fresh[at]) continue;
+            fresh[at] = 1;
+            if (value[at] != 0) continue;
+            for (int dr = -1; dr <= 1; dr++)
+                for (int dc = -1; dc <= 1; dc++)
+                {
+                    int rr = at / size + dr, cc = at % size + dc;
+                    if (rr >= 0 && rr < size && cc >= 0 && cc < size) stack.push_back(rr * size + cc);
+                }
+        }
+
+        bool cleared = true;
+        for (int i = 0; i < size * size; i++)
+        {
+            if (fresh[i])
+            {
+                opened[i] = 1;
+                delta.insert(delta.end(), { (uint8_t)(i / size), (uint8_t)(i % size), value[i] });
+            }
+            if (!opened[i] && value[i] != MINE) cleared = false;
+        }
+
+        if (opened[k] && value[k] == MINE) { gameOver = true; return STATUS_LOSE; }
+        if (cleared) { gameOver = true; return STATUS_WIN; }
+        return STATUS_OK;
+    }
+
+    void Handle(uint8_t cmd, uint8_t seq, std::span<const uint8_t> payload)
+    {
+        switch (cmd)
+        {
+        case CMD_ECHO:
+            if (payload.size() > ECHO_MAX_PAYLOAD) Reply(cmd, seq, STATUS_ERR, {});
+            else Reply(cmd, seq, STATUS_OK, payload);
+            break;
+
+        case CMD_BAUD:
+            Reply(cmd, seq, STATUS_OK, {});
+            if (payload.size() == 4)
+                baud = payload[0] | (payload[1] << 8) | (payload[2] << 16) | ((uint32_t)payload[3] << 24);
+            break;
+
+        case CMD_LINK:
+            Reply(cmd, seq, STATUS_OK, linkId);
+            break;
+
+        case CMD_MINEFIELD:
+            if (payload.size() != 1) { Reply(cmd, seq, STATUS_ERR, {}); break; }
+            NewGame(payload[0]);
+            Reply(cmd, seq, STATUS_OK, value);
+            break;
+
+        case CMD_CLICK:
+        {
+            if (payload.size() != 2 || gameOver || payload[0] >= size || payload[1] >= size)
+            {
+                Reply(cmd, seq, STATUS_ERR, {});
+                break;
+            }
+            std::vector<uint8_t> delta;
+            uint8_t status = Click(payload[0], payload[1], delta);
+            Reply(cmd, seq, status, delta);
+            break;
+        }
+
+        case CMD_ABORT:
+            gameOver = true;
+            break;
+
+        default:
+            if (seq != 0) Reply(cmd, seq, STATUS_ERR, {});
+        }
+    }
+
+    // Same recovery as the firmware: a bad length or CRC drops only the SOF
+    void Decode()
+    {
+        size_t i = 0;
+        while (i < rx.size())
+        {
+            if (rx[i] != FRAME_SOF) { i++; continue; }
+            if (rx.size() - i < TX_HEADER_SIZE) break;
+
+            size_t len = rx[i + 3] | (rx[i + 4] << 8);
+            size_t total = TX_HEADER_SIZE + len + FRAME_CRC_SIZE;
+            if (len > ECHO_MAX_PAYLOAD) { i++; continue; }
+            if (rx.size() - i < total) break;
+
+            const uint8_t* f = &rx[i];
+            size_t body = total - FRAME_CRC_SIZE;
+            uint32_t got = f[body] | (f[body + 1] << 8) | (f[body + 2] << 16) | ((uint32_t)f[body + 3] << 24);
+            if (got != Crc32(CRC_INIT, { f, body })) { i++; continue; }
+
+            Handle(f[1], f[2], { f + TX_HEADER_SIZE, len });
+            i += total;
+        }
+        rx.erase(rx.begin(), rx.begin() + i);
+    }
+
+public:
+    LinkSimulator(int fd, const SimulatorConfig& c) : master(fd), cfg(c) {}
+
+    void Run()
+    {
+        uint8_t buf[1024];
+        for (;;)
+        {
+            pollfd p = { master, POLLIN, 0 };
+            if (poll(&p, 1, -1) < 0 && errno != EINTR) return;
+
+            ssize_t r = read(master, buf, sizeof(buf));
+            if (r < 0 && errno != EINTR && errno != EAGAIN) return;
+            if (r <= 0) continue;
+
+            rx.insert(rx.end(), buf, buf + r);
+            Decode();
+        }
+    }
+};
+}
+
+std::string StartLinkSimulator(const SimulatorConfig& cfg)
+{
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+    {
+        if (master >= 0) close(master);
+        return std::string();
+    }
+    std::string path = ptsname(master);
+
+    // Keeping the slave open stops reads on the master failing with EIO
+    // before and between the client's opens
+    int slave = open(path.c_str(), O_RDWR | O_NOCTTY);
+    if (slave < 0)
+    {
+        close(master);
+        return std::string();
+    }
+    termios tio;
+    if (tcgetattr(slave, &tio) == 0)
+    {
+        cfmakeraw(&tio);
+        tcsetattr(slave, TCSANOW, &tio);
+    }
+
+    // Runs until the process exits
+    std::thread([master, cfg]() { LinkSimulator(master, cfg).Run(); }).detach();
+    return path;
+}
+#endif
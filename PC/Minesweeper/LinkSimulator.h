@@ -0,0 +1,17 @@
+#pragma once
+#include <string>
+
+// ================= LINK SIMULATOR =================
+// Stands in for the STM32 on a pseudo-terminal, so --bench-link and
+// --bench-clicks run without hardware. Answers LINK, ECHO, BAUD, MINEFIELD
+// and CLICK like the firmware and holds every reply back for the time it
+// would take on a UART at the current rate.
+// POSIX only: LinkSimulator.cpp.
+
+struct SimulatorConfig
+{
+    double corruptRate = 0;     // share of replies that get one byte flipped
+};
+
+// Starts the simulator thread; returns the path to open, empty on failure
+std::string StartLinkSimulator(const SimulatorConfig& cfg);
@@ -0,0 +1,143 @@
+#include "Protocol.h"
+
+// One entry per value of the top byte, built at compile time
+static constexpr std::array<uint32_t, 256> MakeCrcTable()
+{
+    std::array<uint32_t, 256> t{};
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        uint32_t c = i << 24;
+        for (int k = 0; k < 8; k++)
+            c = (c & 0x80000000u) ? (c << 1) ^ 0x04C11DB7u : c << 1;
+        t[i] = c;
+    }
+    return t;
+}
+
+const std::array<uint32_t, 256> crcTable = MakeCrcTable();
+
+const std::array<uint8_t, LINK_ID_SIZE> linkId = { 'M', 'S', 'W', 'P', 1 };
+
+uint32_t Crc32(uint32_t crc, std::span<const uint8_t> data)
+{
+    for (uint8_t b : data) crc = CrcUpdate(crc, b);
+    return crc;
+}
+
+size_t EncodePacket(std::span<uint8_t> out, char cmd, uint8_t seq, std::span<const uint8_t> payload)
+{
+    size_t total = TX_HEADER_SIZE + payload.size() + FRAME_CRC_SIZE;
+    if (total > out.size()) return 0;
+
+    out[0] = FRAME_SOF;
+    out[1] = (uint8_t)cmd;
+    out[2] = seq;
+    out[3] = (uint8_t)(payload.size() & 0xFF);
+    out[4] = (uint8_t)(payload.size() >> 8);
+    for (size_t i = 0; i < payload.size(); i++)
+        out[TX_HEADER_SIZE + i] = payload[i];
+
+    size_t body = total - FRAME_CRC_SIZE;
+    uint32_t crc = Crc32(CRC_INIT, out.first(body));
+    for (size_t i = 0; i < FRAME_CRC_SIZE; i++)
+        out[body + i] = (uint8_t)(crc >> (8 * i));
+    return total;
+}
+
+size_t PacketParser::Feed(const uint8_t* data, size_t n)
+{
+    size_t room = RING_SIZE - (head - tail);
+    size_t take = n < room ? n : room;
+
+    for (size_t i = 0; i < take; i++)
+    {
+        size_t k = (head + i) & (RING_SIZE - 1);
+        ring[k] = data[i];
+        ring[k + RING_SIZE] = data[i];
+    }
+    head += take;
+
+    stats.overflowBytes += n - take;
+    return take;
+}
+
+// Drops the SOF of a bad frame and rescans from the byte after it
+void PacketParser::Resync()
+{
+    stats.corrupt++;
+    tail++;
+    pos = tail;
+    step = Step::Sof;
+}
+
+void PacketParser::Abandon()
+{
+    if (step != Step::Sof) Resync();
+}
+
+bool PacketParser::Next(PacketView& out)
+{
+    while (pos != head)
+    {
+        uint8_t b = At(pos);
+
+        switch (step)
+        {
+        case Step::Sof:
+            pos++;
+            if (b == FRAME_SOF)
+            {
+                crc = CrcUpdate(CRC_INIT, b);
+                step = Step::Header;
+            }
+            else
+            {
+                stats.skippedBytes++;
+                tail = pos;
+            }
+            break;
+
+        case Step::Header:
+            crc = CrcUpdate(crc, b);
+            pos++;
+            if (pos - tail == RX_HEADER_SIZE)
+            {
+                len = At(tail + 4) | (At(tail + 5) << 8);
+                if (len > MAX_PAYLOAD) Resync();
+                else step = Step::Body;
+            }
+            break;
+
+        case Step::Body:
+        {
+            size_t body = (size_t)RX_HEADER_SIZE + len;
+            pos++;
+            if (pos - tail <= body)
+            {
+                crc = CrcUpdate(crc, b);
+                break;
+            }
+            if (pos - tail < body + FRAME_CRC_SIZE) break;
+
+            uint32_t got = At(tail + body) | (At(tail + body + 1) << 8) |
+                           (At(tail + body + 2) << 16) | ((uint32_t)At(tail + body + 3) << 24);
+            if (got != crc)
+            {
+                Resync();
+                break;
+            }
+
+            out.cmd = (char)At(tail + 1);
+            out.seq = At(tail + 2);
+            out.status = At(tail + 3);
+            out.payload = std::span<const uint8_t>(&ring[(tail + RX_HEADER_SIZE) & (RING_SIZE - 1)], len);
+
+            tail = pos;
+            step = Step::Sof;
+            stats.frames++;
+            return true;
+        }
+        }
+    }
+    return false;
+}
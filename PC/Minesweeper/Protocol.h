@@ -0,0 +1,125 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <span>
+
+// ================= PROTOCOL =================
+#define CMD_MINEFIELD 'M'
+#define CMD_CLICK     'C'
+#define CMD_ABORT     'A'
+#define CMD_FLAG      'F'
+#define CMD_TIMER     'T'
+#define CMD_BAUD      'B'     // 4-byte LE rate to switch to, empty to confirm it
+#define CMD_NAK       'N'     // seq of a lost reply; answered with the whole board,
+                              // 0xFF closed, 0xFE flagged, else the cell value
+#define CMD_ECHO      'E'     // link test, the payload comes back unchanged
+#define CMD_LINK      'L'     // handshake, answered with LINK_ID
+#define CMD_STATE     'S'     // answered like NAK, or empty when no game is running
+
+#define DIFF_EASY     'E'
+#define DIFF_MEDIUM   'M'
+#define DIFF_HARD     'H'
+
+#define STATUS_OK     0x00
+#define STATUS_LOSE   0x01
+#define STATUS_WIN    0x02
+#define STATUS_ERR    0xFF
+
+// Frames: PC->STM32  sof, cmd, seq, lenLo, lenHi, payload, crc
+//         STM32->PC  sof, cmd, seq, status, lenLo, lenHi, payload, crc
+// crc is the CRC-32/MPEG-2 of every byte before it, sof included, sent
+// little-endian. A reply carries the seq of its request. Requests that get
+// a reply use seq 1..255; FLAG, ABORT and unsolicited frames such as TIMER
+// use 0.
+#define FRAME_SOF      0xAA
+#define TX_HEADER_SIZE 5
+#define RX_HEADER_SIZE 6
+#define FRAME_CRC_SIZE 4
+#define MAX_PAYLOAD    4096     // a full 30x30 click reveal is 2700 bytes
+
+#define MAX_REQUEST_PAYLOAD 8
+#define MAX_REQUEST_FRAME   (TX_HEADER_SIZE + MAX_REQUEST_PAYLOAD + FRAME_CRC_SIZE)
+
+#define ECHO_MAX_PAYLOAD    255
+#define MAX_ECHO_FRAME      (TX_HEADER_SIZE + ECHO_MAX_PAYLOAD + FRAME_CRC_SIZE)
+
+// LINK reply payload: "MSWP" and the protocol version
+#define LINK_ID_SIZE 5
+extern const std::array<uint8_t, LINK_ID_SIZE> linkId;
+
+// ================= CRC =================
+// CRC-32/MPEG-2: polynomial 0x04C11DB7, init 0xFFFFFFFF, no bit reversal,
+// no final XOR. It is what the STM32 CRC unit computes out of reset.
+#define CRC_INIT 0xFFFFFFFFu
+
+extern const std::array<uint32_t, 256> crcTable;
+
+inline uint32_t CrcUpdate(uint32_t crc, uint8_t b)
+{
+    return (crc << 8) ^ crcTable[(crc >> 24) ^ b];
+}
+
+uint32_t Crc32(uint32_t crc, std::span<const uint8_t> data);
+
+// Builds a PC->STM32 frame in out. Returns its length, 0 if it does not fit.
+size_t EncodePacket(std::span<uint8_t> out, char cmd, uint8_t seq, std::span<const uint8_t> payload);
+
+// A decoded frame. payload points into the parser's ring and stays valid
+// until the next Feed().
+struct PacketView
+{
+    char cmd = 0;
+    uint8_t seq = 0;
+    uint8_t status = 0;
+    std::span<const uint8_t> payload;
+};
+
+// ================= PACKET PARSER =================
+// Byte-driven frame decoder over a ring buffer. Bytes outside a frame are
+// skipped until the next FRAME_SOF. A frame whose length or CRC is bad
+// is abandoned just after its SOF and the bytes already buffered are
+// scanned again, so the next good frame is found without waiting for more
+// input.
+// Every byte is stored twice, RING_SIZE apart, so any frame in the ring is
+// also contiguous in memory and can be handed out as a span without copying.
+class PacketParser
+{
+public:
+    struct Stats
+    {
+        uint64_t frames = 0;          // delivered
+        uint64_t corrupt = 0;         // started with FRAME_SOF, bad length or CRC
+        uint64_t skippedBytes = 0;    // discarded while looking for FRAME_SOF
+        uint64_t overflowBytes = 0;   // lost because the ring was full
+    };
+
+    // Copies as much of data as fits, returns the number of bytes taken
+    size_t Feed(const uint8_t* data, size_t n);
+
+    // Decodes the next complete frame, false until one is buffered
+    bool Next(PacketView& out);
+
+    // Gives up on a frame whose rest never came, e.g. because a corrupt
+    // length made it look longer, and rescans the bytes after its SOF
+    void Abandon();
+
+    const Stats& GetStats() const { return stats; }
+
+private:
+    static const size_t RING_SIZE = 8192;   // power of two, holds a whole frame
+
+    enum class Step { Sof, Header, Body };
+
+    uint8_t ring[2 * RING_SIZE];
+    size_t head = 0;    // next write; indexes are free-running
+    size_t tail = 0;    // first byte of the frame being parsed
+    size_t pos = 0;     // next byte to examine, tail <= pos <= head
+    Step step = Step::Sof;
+    uint16_t len = 0;
+    uint32_t crc = 0;
+    Stats stats;
+
+    uint8_t At(size_t i) const { return ring[i & (RING_SIZE - 1)]; }
+    void Resync();
+};
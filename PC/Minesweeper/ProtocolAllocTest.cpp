@@ -0,0 +1,116 @@
+// Counts heap allocations on the per-click protocol path: encoding a CLICK
+// request, then feeding and decoding its reply. After a warm-up round the
+// count must not move at all.
+#include "Protocol.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+// ================= ALLOCATION COUNTER =================
+static std::atomic<size_t> allocations{ 0 };
+
+void* operator new(size_t n)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t n)
+{
+    return operator new(n);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+
+// ================= STM32 SIDE =================
+// A CLICK reply as the firmware frames it: (row, col, value) per opened cell
+static size_t EncodeReply(std::span<uint8_t> out, uint8_t seq, size_t cells)
+{
+    size_t len = cells * 3;
+    out[0] = FRAME_SOF;
+    out[1] = CMD_CLICK;
+    out[2] = seq;
+    out[3] = STATUS_OK;
+    out[4] = (uint8_t)(len & 0xFF);
+    out[5] = (uint8_t)(len >> 8);
+    for (size_t i = 0; i < cells; i++)
+    {
+        out[RX_HEADER_SIZE + 3 * i] = (uint8_t)(i / 30);
+        out[RX_HEADER_SIZE + 3 * i + 1] = (uint8_t)(i % 30);
+        out[RX_HEADER_SIZE + 3 * i + 2] = (uint8_t)(i % 9);
+    }
+
+    size_t body = RX_HEADER_SIZE + len;
+    uint32_t crc = Crc32(CRC_INIT, out.first(body));
+    for (size_t i = 0; i < FRAME_CRC_SIZE; i++)
+        out[body + i] = (uint8_t)(crc >> (8 * i));
+    return body + FRAME_CRC_SIZE;
+}
+
+static bool failed = false;
+
+static void Check(bool ok, const char* what)
+{
+    if (ok) return;
+    std::printf("FAILED: %s\n", what);
+    failed = true;
+}
+
+// ================= CLICK PATH =================
+// One click: request out, reply in, delivered in chunks the way a serial
+// read returns them
+static void Click(PacketParser& parser, uint8_t seq, size_t cells, std::span<uint8_t> wire)
+{
+    std::array<uint8_t, MAX_REQUEST_FRAME> request;
+    const uint8_t rowCol[2] = { (uint8_t)(seq % 30), (uint8_t)(seq / 30) };
+    Check(EncodePacket(request, CMD_CLICK, seq, rowCol) == TX_HEADER_SIZE + 2 + FRAME_CRC_SIZE, "encode");
+
+    size_t n = EncodeReply(wire, seq, cells);
+    size_t chunk = 1 + seq % 97;
+    PacketView v;
+    bool got = false;
+    for (size_t at = 0; at < n; at += chunk)
+    {
+        parser.Feed(wire.data() + at, std::min(chunk, n - at));
+        while (parser.Next(v))
+            got = v.cmd == CMD_CLICK && v.seq == seq && v.payload.size() == cells * 3;
+    }
+    Check(got, "reply decoded");
+}
+
+int main()
+{
+    static std::array<uint8_t, RX_HEADER_SIZE + MAX_PAYLOAD + FRAME_CRC_SIZE> wire;
+    static PacketParser parser;
+    const int clicks = 100000;
+
+    // The counter sees what operator new hands out
+    size_t base = allocations.load();
+    std::vector<uint8_t> probe(16);
+    Check(allocations.load() == base + 1, "allocation counter");
+
+    // Warm-up: anything the library sets up lazily happens here
+    Click(parser, 1, 1, wire);
+
+    size_t before = allocations.load();
+    for (int i = 0; i < clicks; i++)
+    {
+        // Mostly single cells, now and then a flood up to a whole 30x30 board
+        size_t cells = i % 50 ? 1 + i % 8 : 1 + (size_t)i * 7 % 900;
+        Click(parser, (uint8_t)(1 + i % 255), cells, wire);
+    }
+    size_t used = allocations.load() - before;
+
+    std::printf("%d clicks: %zu heap allocations, %llu frames decoded, %llu corrupt\n", clicks, used,
+                (unsigned long long)parser.GetStats().frames, (unsigned long long)parser.GetStats().corrupt);
+    Check(used == 0, "no heap allocations per click");
+    Check(parser.GetStats().corrupt == 0, "no corrupt frames");
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,19 @@
+#ifdef __linux__
+// Kept apart from SerialPosix.cpp: <asm/termbits.h> clashes with <termios.h>
+#include <asm/termbits.h>
+#include <sys/ioctl.h>
+#include <cstdint>
+
+// Arbitrary baud rates through termios2/BOTHER
+bool SetCustomBaud(int fd, uint32_t baud)
+{
+    struct termios2 tio;
+    if (ioctl(fd, TCGETS2, &tio) != 0) return false;
+
+    tio.c_cflag &= ~CBAUD;
+    tio.c_cflag |= BOTHER;
+    tio.c_ispeed = baud;
+    tio.c_ospeed = baud;
+    return ioctl(fd, TCSETS2, &tio) == 0;
+}
+#endif
@@ -0,0 +1,189 @@
+#ifndef _WIN32
+#include "SerialTransport.h"
+#include <fcntl.h>
+#include <glob.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <cerrno>
+
+#ifdef __linux__
+bool SetCustomBaud(int fd, uint32_t baud);     // SerialLinuxBaud.cpp
+#endif
+
+static speed_t StandardSpeed(uint32_t baud)
+{
+    switch (baud)
+    {
+    case 9600:   return B9600;
+    case 19200:  return B19200;
+    case 38400:  return B38400;
+    case 57600:  return B57600;
+    case 115200: return B115200;
+    case 230400: return B230400;
+#ifdef B460800
+    case 460800: return B460800;
+#endif
+#ifdef B921600
+    case 921600: return B921600;
+#endif
+    default:     return 0;
+    }
+}
+
+// Writes tio with the rate set; rates without a Bxxx constant go through
+// termios2 on Linux and are refused elsewhere
+static bool ApplyBaud(int fd, termios& tio, uint32_t baud)
+{
+    speed_t speed = StandardSpeed(baud);
+    if (speed)
+    {
+        cfsetispeed(&tio, speed);
+        cfsetospeed(&tio, speed);
+    }
+
+    bool ok = tcsetattr(fd, TCSANOW, &tio) == 0;
+#ifdef __linux__
+    if (ok && !speed) ok = SetCustomBaud(fd, baud);
+#else
+    if (!speed) ok = false;
+#endif
+    return ok;
+}
+
+// ================= POSIX BACKEND =================
+// read() never blocks (VMIN = VTIME = 0 by default); Read waits in poll()
+// on the tty and on a self-pipe that Wake writes to
+class SerialPosix : public SerialTransport
+{
+    int fd;
+    int wakePipe[2];
+
+public:
+    SerialPosix(int tty, int pipeRead, int pipeWrite) : fd(tty)
+    {
+        wakePipe[0] = pipeRead;
+        wakePipe[1] = pipeWrite;
+    }
+
+    ~SerialPosix() override
+    {
+        close(wakePipe[0]);
+        close(wakePipe[1]);
+        close(fd);
+    }
+
+    bool Write(const uint8_t* data, size_t len) override
+    {
+        while (len)
+        {
+            ssize_t w = write(fd, data, len);
+            if (w < 0)
+            {
+                if (errno == EINTR) continue;
+                if (errno != EAGAIN) return false;
+
+                pollfd p = { fd, POLLOUT, 0 };
+                if (poll(&p, 1, -1) < 0 && errno != EINTR) return false;
+                continue;
+            }
+            data += w;
+            len -= (size_t)w;
+        }
+        return true;
+    }
+
+    long Read(uint8_t* buf, size_t cap, int timeoutMs) override
+    {
+        for (;;)
+        {
+            ssize_t r = read(fd, buf, cap);
+            if (r > 0) return (long)r;
+            if (r < 0 && errno != EAGAIN && errno != EINTR) return -1;
+
+            pollfd p[2] = { { fd, POLLIN, 0 }, { wakePipe[0], POLLIN, 0 } };
+            int n = poll(p, 2, timeoutMs);
+            if (n < 0)
+            {
+                if (errno == EINTR) continue;
+                return -1;
+            }
+            if (n == 0) return 0;
+
+            if (p[1].revents & POLLIN)
+            {
+                uint8_t drain[16];
+                while (read(wakePipe[0], drain, sizeof(drain)) > 0) {}
+                return 0;
+            }
+            if (p[0].revents & (POLLERR | POLLHUP | POLLNVAL)) return -1;
+        }
+    }
+
+    void Wake() override
+    {
+        uint8_t b = 1;
+        (void)!write(wakePipe[1], &b, 1);
+    }
+
+    bool SetBaud(uint32_t baud) override
+    {
+        termios tio;
+        if (tcdrain(fd) != 0 || tcgetattr(fd, &tio) != 0) return false;
+        return ApplyBaud(fd, tio, baud);
+    }
+};
+
+std::unique_ptr<SerialTransport> SerialTransport::Open(const std::string& port, const SerialConfig& cfg)
+{
+    int fd = open(port.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) return nullptr;
+
+    termios tio;
+    if (tcgetattr(fd, &tio) != 0)
+    {
+        close(fd);
+        return nullptr;
+    }
+
+    // 8N1, no echo, no line discipline, no flow control
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cflag &= ~(CSTOPB | CRTSCTS);
+    tio.c_cc[VMIN] = cfg.vmin;
+    tio.c_cc[VTIME] = cfg.vtime;
+
+    bool ok = ApplyBaud(fd, tio, cfg.baud);
+
+    // VMIN/VTIME only take effect on a blocking descriptor; the defaults
+    // keep read() non-blocking either way
+    if (ok && (cfg.vmin || cfg.vtime))
+        ok = fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK) == 0;
+
+    int pipeFds[2];
+    if (!ok || pipe(pipeFds) != 0)
+    {
+        close(fd);
+        return nullptr;
+    }
+    fcntl(pipeFds[0], F_SETFL, O_NONBLOCK);
+    fcntl(pipeFds[1], F_SETFL, O_NONBLOCK);
+
+    tcflush(fd, TCIOFLUSH);
+    return std::make_unique<SerialPosix>(fd, pipeFds[0], pipeFds[1]);
+}
+
+// USB CDC (ST-LINK VCP) and USB-serial adapters; Linux and macOS names
+std::vector<std::string> SerialTransport::List()
+{
+    std::vector<std::string> ports;
+    for (const char* pattern : { "/dev/ttyACM*", "/dev/ttyUSB*", "/dev/cu.usbmodem*", "/dev/cu.usbserial*" })
+    {
+        glob_t g;
+        if (glob(pattern, 0, nullptr, &g) == 0)
+            ports.insert(ports.end(), g.gl_pathv, g.gl_pathv + g.gl_pathc);
+        globfree(&g);
+    }
+    return ports;
+}
+#endif
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+// ================= SERIAL TRANSPORT =================
+// Byte pipe to the STM32. One thread does Write/Read, any thread may Wake.
+// Backends: SerialWin32.cpp (overlapped I/O + WaitCommEvent) and
+// SerialPosix.cpp (termios + poll).
+
+struct SerialConfig
+{
+    uint32_t baud = 115200;     // any rate the driver accepts, not only the standard ones
+
+    // POSIX only: termios VMIN/VTIME used by read(). The defaults make read()
+    // return at once with what is buffered; Read() waits in poll() instead.
+    uint8_t vmin = 0;
+    uint8_t vtime = 0;          // tenths of a second
+};
+
+class SerialTransport
+{
+public:
+    virtual ~SerialTransport() {}
+
+    // Sends all of data, false if the port failed
+    virtual bool Write(const uint8_t* data, size_t len) = 0;
+
+    // Copies already buffered bytes into buf. If none are buffered, waits up to
+    // timeoutMs (-1 forever) for some to arrive or for Wake().
+    // Returns the byte count, 0 on timeout/wake, -1 if the port failed.
+    virtual long Read(uint8_t* buf, size_t cap, int timeoutMs) = 0;
+
+    // Makes a pending or the next Read() return early
+    virtual void Wake() = 0;
+
+    // Changes the line rate of the open port once queued output has gone out.
+    // Only call it from the thread that does Write/Read.
+    virtual bool SetBaud(uint32_t baud) = 0;
+
+    static std::unique_ptr<SerialTransport> Open(const std::string& port, const SerialConfig& cfg = SerialConfig());
+
+    // Names of the ports the STM32 could be on, for Open(). Only lists what
+    // exists right now; nothing is opened.
+    static std::vector<std::string> List();
+};
@@ -0,0 +1,155 @@
+#ifdef _WIN32
+#include "SerialTransport.h"
+#include <windows.h>
+#include <cstring>
+#include <cstdlib>
+
+// ================= WIN32 BACKEND =================
+// Opened for overlapped I/O: Read sleeps in WaitCommEvent and is woken by
+// incoming bytes or by Wake, never by a timeout
+class SerialWin32 : public SerialTransport
+{
+    HANDLE h;
+    HANDLE wake;
+    OVERLAPPED commOv = { 0 }, readOv = { 0 }, writeOv = { 0 };
+    DWORD commMask = 0;
+    bool commPending = false;
+
+    // Runs one overlapped ReadFile/WriteFile to completion
+    bool FinishIo(BOOL started, OVERLAPPED& ov, DWORD& done)
+    {
+        if (!started && GetLastError() != ERROR_IO_PENDING)
+            return false;
+        return GetOverlappedResult(h, &ov, &done, TRUE) != 0;
+    }
+
+    long ReadBuffered(uint8_t* buf, size_t cap)
+    {
+        DWORD r = 0;
+        if (!FinishIo(ReadFile(h, buf, (DWORD)cap, &r, &readOv), readOv, r))
+            return -1;
+        return (long)r;
+    }
+
+    bool Queued(DWORD& n)
+    {
+        DWORD errors;
+        COMSTAT stat;
+        if (!ClearCommError(h, &errors, &stat)) return false;
+        n = stat.cbInQue;
+        return true;
+    }
+
+public:
+    explicit SerialWin32(HANDLE port) : h(port)
+    {
+        wake = CreateEventA(nullptr, FALSE, FALSE, nullptr);
+        commOv.hEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+        readOv.hEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+        writeOv.hEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+    }
+
+    ~SerialWin32() override
+    {
+        if (commPending)
+        {
+            DWORD unused;
+            CancelIo(h);
+            GetOverlappedResult(h, &commOv, &unused, TRUE);
+        }
+        CloseHandle(commOv.hEvent);
+        CloseHandle(readOv.hEvent);
+        CloseHandle(writeOv.hEvent);
+        CloseHandle(wake);
+        CloseHandle(h);
+    }
+
+    bool Write(const uint8_t* data, size_t len) override
+    {
+        DWORD w = 0;
+        return FinishIo(WriteFile(h, data, (DWORD)len, &w, &writeOv), writeOv, w) && w == len;
+    }
+
+    long Read(uint8_t* buf, size_t cap, int timeoutMs) override
+    {
+        long n = ReadBuffered(buf, cap);
+        if (n != 0) return n;
+
+        if (!commPending)
+        {
+            ResetEvent(commOv.hEvent);
+            if (WaitCommEvent(h, &commMask, &commOv)) return ReadBuffered(buf, cap);
+            if (GetLastError() != ERROR_IO_PENDING) return -1;
+            commPending = true;
+        }
+
+        // Bytes that landed between ReadFile and WaitCommEvent raise no event
+        DWORD queued = 0;
+        if (!Queued(queued)) return -1;
+        if (queued) return ReadBuffered(buf, cap);
+
+        HANDLE waitOn[2] = { commOv.hEvent, wake };
+        DWORD r = WaitForMultipleObjects(2, waitOn, FALSE, timeoutMs < 0 ? INFINITE : (DWORD)timeoutMs);
+        if (r != WAIT_OBJECT_0) return 0;
+
+        DWORD unused;
+        commPending = false;
+        if (!GetOverlappedResult(h, &commOv, &unused, FALSE)) return -1;
+        return ReadBuffered(buf, cap);
+    }
+
+    void Wake() override
+    {
+        SetEvent(wake);
+    }
+
+    bool SetBaud(uint32_t baud) override
+    {
+        DCB dcb = { 0 };
+        dcb.DCBlength = sizeof(dcb);
+        if (!FlushFileBuffers(h) || !GetCommState(h, &dcb)) return false;
+        dcb.BaudRate = baud;
+        return SetCommState(h, &dcb) != 0;
+    }
+};
+
+std::unique_ptr<SerialTransport> SerialTransport::Open(const std::string& port, const SerialConfig& cfg)
+{
+    HANDLE h = CreateFileA(port.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr,
+        OPEN_EXISTING, FILE_FLAG_OVERLAPPED, nullptr);
+    if (h == INVALID_HANDLE_VALUE) return nullptr;
+
+    // DCB takes the rate as a plain number, so non-standard rates pass through
+    DCB dcb = { 0 };
+    dcb.DCBlength = sizeof(dcb);
+    GetCommState(h, &dcb);
+    dcb.BaudRate = cfg.baud;
+    dcb.ByteSize = 8;
+    dcb.StopBits = ONESTOPBIT;
+    dcb.Parity = NOPARITY;
+    if (!SetCommState(h, &dcb))
+    {
+        CloseHandle(h);
+        return nullptr;
+    }
+
+    // ReadFile returns at once with whatever is already buffered
+    COMMTIMEOUTS t = { MAXDWORD,0,0,0,0 };
+    SetCommTimeouts(h, &t);
+
+    SetCommMask(h, EV_RXCHAR | EV_ERR);
+    return std::make_unique<SerialWin32>(h);
+}
+
+// Every COMn the system knows, USB ones included, from the DOS device names
+std::vector<std::string> SerialTransport::List()
+{
+    std::vector<std::string> ports;
+    std::vector<char> names(65536);
+    DWORD n = QueryDosDeviceA(nullptr, names.data(), (DWORD)names.size());
+    for (const char* p = names.data(); n && *p; p += strlen(p) + 1)
+        if (strncmp(p, "COM", 3) == 0 && atoi(p + 3) > 0)
+            ports.push_back(std::string("\\\\.\\") + p);
+    return ports;
+}
+#endif
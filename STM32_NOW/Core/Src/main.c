@@ -8,17 +8,52 @@
 /* USER CODE END Header */
 
 #include "main.h"
-#include <stdlib.h>
 #include <string.h>
-#include <stdio.h>
 
 /* ================= DEFINES ================= */
-#define RX_BUFFER_SIZE 64
-#define TX_BUFFER_SIZE 256
+#define RX_BUFFER_SIZE 272   /* an ECHO frame with ECHO_MAX_PAYLOAD */
+#define RX_RING_SIZE   512   /* power of two, filled by circular DMA */
+#define RX_FRAME_TIMEOUT 50  /* ms of silence that abandons a partial frame */
+#define TX_WINDOW_SIZE 64
+#define TX_QUEUE_SIZE  8     /* power of two, frames waiting to be sent */
+#define TX_HEADER_SIZE 6
+
+#define UART_DEFAULT_BAUD    115200  /* rate after reset and after every fallback */
+#define UART_MIN_BAUD        9600
+#define BAUD_CONFIRM_TIMEOUT 500     /* ms the PC gets to confirm a new rate */
+
+/* Frames: PC->MCU  sof, cmd, seq, lenLo, lenHi, payload, crc
+           MCU->PC  sof, cmd, seq, status, lenLo, lenHi, payload, crc
+   crc is the CRC-32/MPEG-2 of every byte before it, sof included, sent
+   little-endian. A reply carries the seq of its request; TIMER frames are
+   unsolicited and use seq 0. */
+#define RX_HEADER_SIZE 5
+#define FRAME_SOF      0xAA
+#define FRAME_CRC_SIZE 4
+#define CRC_INIT_VALUE 0xFFFFFFFFu
+/* CRC unit access; the host tests build this file against a software model
+   of the unit and bring their own */
+#ifndef CRC_PUT
+#define CRC_PUT(b)     (*(__IO uint8_t *)&CRC->DR = (b))   /* feeds one byte */
+#define CRC_VALUE()    (CRC->DR)                          /* CRC of what was fed */
+#endif
 
 #define CMD_MINEFIELD 'M'
 #define CMD_CLICK     'C'
 #define CMD_ABORT     'A'
+#define CMD_FLAG      'F'
+#define CMD_TIMER     'T'
+#define CMD_BAUD      'B'
+#define CMD_NAK       'N'
+#define CMD_ECHO      'E'
+#define CMD_LINK      'L'
+#define CMD_STATE     'S'
+
+#define ECHO_MAX_PAYLOAD 255
+
+/* LINK reply: tells this firmware apart from whatever else sits on a port */
+#define LINK_ID_SIZE  5
+#define LINK_VERSION  1
 
 #define DIFF_EASY     'E'
 #define DIFF_MEDIUM   'M'
@@ -29,122 +64,356 @@
 #define STATUS_WIN    0x02
 #define STATUS_ERR    0xFF
 
-#define MAX_SIZE 15
-#define MINE     -1
-#define FLAG     254
+/* NAK and STATE snapshot cells that are not open */
+#define SNAPSHOT_CLOSED 0xFF
+#define SNAPSHOT_FLAG   0xFE
+
+/* Boards are stored with a one-cell sentinel border: playable cells are rows and
+   bits 1..fieldSize, row 0, row fieldSize+1 and bits 0, fieldSize+1 stay empty.
+   One uint32_t per row in every bit plane, so MAX_SIZE can not exceed 30. */
+#define MAX_SIZE     30
+#define BOARD_STRIDE (MAX_SIZE+2)
+#define MINE         9
+
+#define BIT(y)           (1u << (y))
+#define ROW_SPREAD(m)    ((m) | ((m) << 1) | ((m) >> 1))
+#define CELL_INDEX(x,y)  ((uint16_t)(x)*BOARD_STRIDE + (y))
+#define ADJ_GET(k)       ((adjacent[(k)>>1] >> (((k)&1)*4)) & 0x0F)
+/* A count never exceeds 8, so adding to one nibble can not carry into the other */
+#define ADJ_INC(k)       (adjacent[(k)>>1] += 1 << (((k)&1)*4))
+#define ADJ_DEC(k)       (adjacent[(k)>>1] -= 1 << (((k)&1)*4))
 
 /* ================= HANDLES ================= */
 UART_HandleTypeDef huart2;
+DMA_HandleTypeDef hdma_usart2_rx;
+DMA_HandleTypeDef hdma_usart2_tx;
 TIM_HandleTypeDef htim2;
 
 /* ================= BUFFERS ================= */
+/* DMA writes rxRing on its own; the main loop is the only reader, so no
+   locking is needed. The DMA counter gives the write position within a lap
+   and rxLaps, bumped at every wrap, the laps, so RX_Written knows how far
+   the DMA has run and UART_Task can tell when it has been lapped. */
+uint8_t rxRing[RX_RING_SIZE];
+volatile uint32_t rxLaps = 0;
+uint32_t rxWritten = 0;     /* bytes written as of the last RX_Written */
+uint32_t rxRead = 0;        /* bytes taken out of rxRing */
+uint16_t rxOverruns = 0;    /* times unread bytes were overwritten */
+/* Set by the error interrupt; UART_Task restarts reception */
+volatile uint8_t rxRestart = 0;
+uint32_t rxLastTick = 0;
+
+/* Frame being assembled from rxRing */
 uint8_t rxBuf[RX_BUFFER_SIZE];
-uint8_t txBuf[TX_BUFFER_SIZE];
-uint8_t rxIndex = 0;
+uint16_t rxIndex = 0;
+/* seq of the request being handled, echoed by its reply */
+uint8_t replySeq = 0;
+
+/* Outgoing frames are queued as small descriptors and only turned into bytes
+   when a TX window frees up, so a full board dump never needs a full-size
+   buffer and no producer ever waits for the wire. */
+typedef struct
+{
+    uint8_t  cmd;
+    uint8_t  seq;
+    uint8_t  status;
+    uint16_t arg;       /* value captured at enqueue time, e.g. the timer */
+} TxFrame;
+
+TxFrame txQueue[TX_QUEUE_SIZE];
+volatile uint8_t txHead = 0;        /* written by producers */
+volatile uint8_t txTail = 0;        /* written by the renderer */
+/* Queued frames rendered from state the next request may change: the live
+   board for CELL_CLICK/MINEFIELD/NAK/STATE, echoBuf for ECHO */
+#define TX_PINS_STATE(cmd) ((cmd) == CMD_CLICK || (cmd) == CMD_MINEFIELD || \
+                            (cmd) == CMD_NAK || (cmd) == CMD_STATE || (cmd) == CMD_ECHO)
+volatile uint8_t txPinned = 0;
+
+/* Two windows: DMA sends one while the other is filled */
+uint8_t txWin[2][TX_WINDOW_SIZE];
+uint8_t txWinLen[2] = {0, 0};
+uint8_t txSpare = 0;
+volatile uint8_t txDmaBusy = 0;
+
+/* Render state of the frame at txTail */
+uint16_t txPos = 0;
+uint16_t txFrameLen = 0;
+uint32_t txCrc = 0;
+uint8_t  txRow = 0;
+uint8_t  txCol = 0;
 
 /* ================= GAME DATA ================= */
-int8_t  minefield[MAX_SIZE][MAX_SIZE];
-uint8_t opened[MAX_SIZE][MAX_SIZE];
+/* Bit planes: bit y of row x is cell (x-1,y-1) as the PC numbers it */
+uint32_t mineRows[BOARD_STRIDE];
+uint32_t openRows[BOARD_STRIDE];
+uint32_t flagRows[BOARD_STRIDE];
+/* Safe cells with no mine around them, filled once per game */
+uint32_t zeroRows[BOARD_STRIDE];
+/* Cells opened by the latest click, sent back as the CELL_CLICK delta */
+uint32_t freshRows[BOARD_STRIDE];
+/* Adjacent mine counts, two cells per byte, indexed by CELL_INDEX */
+uint8_t  adjacent[BOARD_STRIDE*BOARD_STRIDE/2];
+
+/* CELL_INDEX offsets of the eight neighbours; the sentinel border keeps them in range */
+const int8_t neighbourOffset[8] =
+{
+    -BOARD_STRIDE-1, -BOARD_STRIDE, -BOARD_STRIDE+1,
+    -1,                             1,
+     BOARD_STRIDE-1,  BOARD_STRIDE,  BOARD_STRIDE+1
+};
+uint32_t rowMask = 0;
 
 uint8_t fieldSize = 0;
 uint8_t mineCount = 0;
-uint16_t openedTotal = 0;
 uint8_t gameOver = 1;
+/* No cell opened yet; the first click is kept off the mines */
+uint8_t firstClick = 0;
+/* Status of the last move, repeated in NAK and STATE snapshots */
+uint8_t gameResult = STATUS_OK;
+/* No board to snapshot: never started, or aborted */
+#define GAME_NONE() (gameOver && gameResult == STATUS_OK)
+
+/* ================= RNG ================= */
+uint32_t rngState = 0x2545F491;
+
+/* ================= LINK TEST ================= */
+/* Payload of the ECHO being answered; the frame pins it until rendered */
+uint8_t echoBuf[ECHO_MAX_PAYLOAD];
+const uint8_t linkId[LINK_ID_SIZE] = { 'M', 'S', 'W', 'P', LINK_VERSION };
 
 /* ================= TIMER ================= */
-uint32_t timerSeconds = 0;
+uint16_t timerSeconds = 0;
 uint8_t timerRunning = 0;
 
+/* ================= BAUD ================= */
+/* A BAUD request is answered at the old rate; the new rate is applied once
+   that reply has left the shift register and stays on trial until the PC
+   confirms it at the new rate. No confirm, or a UART error while off the
+   default rate, puts the link back on UART_DEFAULT_BAUD. */
+uint32_t baudPending = 0;
+uint8_t  baudTrial = 0;
+uint32_t baudTrialTick = 0;
+volatile uint8_t baudFailed = 0;
+
 /* ================= PROTOTYPES ================= */
 void SystemClock_Config(void);
 static void MX_GPIO_Init(void);
+static void MX_DMA_Init(void);
 static void MX_USART2_UART_Init(void);
 static void MX_TIM2_Init(void);
-
-uint8_t XOR_Checksum(uint8_t *data, uint16_t len);
+static void MX_CRC_Init(void);
+
+void CRC_Load(uint32_t crc);
+uint32_t CRC_Frame(uint8_t *data, uint16_t len);
+void RNG_Init(void);
+void RNG_Seed(uint32_t seed);
+uint32_t RNG_Next(void);
+void UART_StartReceive(void);
+uint32_t RX_Written(void);
+void UART_SetBaud(uint32_t baud);
 void UART_Task(void);
-void ProcessPacket(uint8_t *packet, uint8_t totalLen);
+void BAUD_Task(void);
+void RX_Feed(uint8_t b);
+void RX_Parse(void);
+void RX_Drop(uint16_t n);
+void ProcessPacket(uint8_t *packet, uint16_t totalLen);
+
+uint8_t TX_Enqueue(uint8_t cmd, uint8_t seq, uint8_t status, uint16_t arg);
+uint8_t TX_CanAccept(void);
+void TX_Reset(void);
+void TX_Pump(void);
+uint8_t TX_Render(uint8_t *dst);
+void TX_StartFrame(TxFrame *f);
+uint8_t TX_NextByte(TxFrame *f);
+void TX_SeekFresh(void);
 
 void GenerateMinefield(uint8_t level);
 void ClearOpened(void);
 void ClearField(void);
 void PlaceMines(void);
-uint8_t CountAdjacent(uint8_t x, uint8_t y);
+void PlaceMine(uint8_t x, uint8_t y);
+void RemoveMine(uint8_t x, uint8_t y);
+void MoveMineFrom(uint8_t x, uint8_t y);
+void FindZeroCells(void);
+uint8_t Popcount32(uint32_t v);
+uint8_t CellValue(uint8_t x, uint8_t y);
 void FloodOpen(uint8_t x, uint8_t y);
+uint8_t IsBoardCleared(void);
 
-void HandleMinefield(uint8_t *packet);
-void HandleClick(uint8_t *packet);
+void HandleMinefield(uint8_t *payload, uint16_t len);
+void HandleClick(uint8_t *payload, uint16_t len);
 void HandleAbort(void);
+void HandleFlag(uint8_t *payload, uint16_t len);
+void HandleBaud(uint8_t *payload, uint16_t len);
+void HandleNak(void);
+void HandleEcho(uint8_t *payload, uint16_t len);
+void HandleLink(void);
+void HandleState(void);
 
 void SendMinefieldResponse(void);
 void SendClickResponse(uint8_t status);
 void SendError(uint8_t cmd, uint8_t err);
 void SendTimer(void);
+void SendBaudResponse(uint8_t status);
+void SendNakResponse(void);
+void SendEchoResponse(uint16_t len);
+void SendLinkResponse(void);
+void SendStateResponse(void);
+
+/* ================= CRC ================= */
+/* CRC-32/MPEG-2 is the CRC unit's reset setup: polynomial 0x04C11DB7, init
+   0xFFFFFFFF, no bit reversal, no final XOR. It is driven through its
+   registers, so no HAL module is needed. The TX renderer and the RX check
+   share the unit, so each loads its own running value first. */
+void CRC_Load(uint32_t crc)
+{
+    CRC->INIT = crc;
+    CRC->CR |= CRC_CR_RESET;
+}
 
-/* ================= CHECKSUM ================= */
-uint8_t XOR_Checksum(uint8_t *data, uint16_t len)
+/* Masks interrupts because the TX renderer may use the unit from the DMA interrupt */
+uint32_t CRC_Frame(uint8_t *data, uint16_t len)
 {
-    uint8_t c = 0;
-    for(uint16_t i=0;i<len;i++) c ^= data[i];
-    return c;
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    CRC_Load(CRC_INIT_VALUE);
+    for(uint16_t i=0;i<len;i++)
+        CRC_PUT(data[i]);
+    uint32_t crc = CRC_VALUE();
+
+    __set_PRIMASK(primask);
+    return crc;
 }
 
 /* ================= RNG ================= */
+/* xorshift32: a few shifts per number, no newlib rand() in flash */
+uint32_t RNG_Next(void)
+{
+    uint32_t x = rngState;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    rngState = x;
+    return x;
+}
+
+void RNG_Seed(uint32_t seed)
+{
+    rngState ^= seed * 0x9E3779B9u;
+    if(!rngState) rngState = 0x2545F491;
+}
+
 void RNG_Init(void)
 {
-    srand(HAL_GetTick());
+    RNG_Seed(HAL_GetTick());
 }
 
 /* ================= FIELD ================= */
 void ClearOpened(void)
 {
-    openedTotal = 0;
-    for(uint8_t i=0;i<fieldSize;i++)
-        for(uint8_t j=0;j<fieldSize;j++)
-            opened[i][j] = 0;
+    for(uint8_t i=0;i<BOARD_STRIDE;i++)
+    {
+        openRows[i] = 0;
+        flagRows[i] = 0;
+        freshRows[i] = 0;
+    }
 }
 
 void ClearField(void)
 {
-    for(uint8_t i=0;i<fieldSize;i++)
-        for(uint8_t j=0;j<fieldSize;j++)
-            minefield[i][j] = 0;
+    rowMask = (BIT(fieldSize) - 1) << 1;
+    for(uint8_t i=0;i<BOARD_STRIDE;i++)
+    {
+        mineRows[i] = 0;
+        zeroRows[i] = 0;
+    }
+    memset(adjacent,0,sizeof(adjacent));
+}
+
+/* Sets the mine bit and bumps the count of every neighbour */
+void PlaceMine(uint8_t x, uint8_t y)
+{
+    uint16_t k = CELL_INDEX(x,y);
+
+    mineRows[x] |= BIT(y);
+    for(uint8_t n=0;n<8;n++)
+        ADJ_INC(k + neighbourOffset[n]);
+}
+
+void RemoveMine(uint8_t x, uint8_t y)
+{
+    uint16_t k = CELL_INDEX(x,y);
+
+    mineRows[x] &= ~BIT(y);
+    for(uint8_t n=0;n<8;n++)
+        ADJ_DEC(k + neighbourOffset[n]);
 }
 
+/* Floyd's sampling: exactly mineCount draws, no retries however dense the board */
 void PlaceMines(void)
 {
-    uint8_t placed = 0;
-    while(placed < mineCount)
+    uint16_t total = (uint16_t)fieldSize*fieldSize;
+
+    for(uint16_t j=total-mineCount; j<total; j++)
     {
-        uint8_t x = rand() % fieldSize;
-        uint8_t y = rand() % fieldSize;
-        if(minefield[x][y] != MINE)
-        {
-            minefield[x][y] = MINE;
-            placed++;
-        }
+        uint16_t t = RNG_Next() % (j+1);
+        if(mineRows[t/fieldSize+1] & BIT(t%fieldSize+1)) t = j;
+        PlaceMine(t/fieldSize+1, t%fieldSize+1);
     }
 }
 
-uint8_t CountAdjacent(uint8_t x, uint8_t y)
+/* Moves a mine at (x,y) to a free cell drawn uniformly from the rest of
+   the board; at most one pass over the rows */
+void MoveMineFrom(uint8_t x, uint8_t y)
 {
-    uint8_t cnt = 0;
-    for(int8_t dx=-1; dx<=1; dx++)
-        for(int8_t dy=-1; dy<=1; dy++)
-        {
-            if(!dx && !dy) continue;
-            int8_t nx = x + dx;
-            int8_t ny = y + dy;
-            if(nx>=0 && ny>=0 && nx<fieldSize && ny<fieldSize)
-                if(minefield[nx][ny] == MINE)
-                    cnt++;
-        }
-    return cnt;
+    uint16_t total = (uint16_t)fieldSize*fieldSize;
+    if(!(mineRows[x] & BIT(y)) || mineCount >= total) return;
+
+    uint16_t t = RNG_Next() % (total - mineCount);
+    for(uint8_t i=1;i<=fieldSize;i++)
+    {
+        uint32_t free = ~mineRows[i] & rowMask;
+        uint8_t n = Popcount32(free);
+        if(t >= n) { t -= n; continue; }
+
+        uint8_t j = 1;
+        for(;;j++)
+            if((free & BIT(j)) && !t--) break;
+
+        RemoveMine(x,y);
+        PlaceMine(i,j);
+        FindZeroCells();
+        return;
+    }
+}
+
+void FindZeroCells(void)
+{
+    for(uint8_t i=1;i<=fieldSize;i++)
+        zeroRows[i] = ~ROW_SPREAD(mineRows[i-1] | mineRows[i] | mineRows[i+1]) & rowMask;
+}
+
+/* Cortex-M0 has no popcount instruction */
+uint8_t Popcount32(uint32_t v)
+{
+    v = v - ((v >> 1) & 0x55555555u);
+    v = (v & 0x33333333u) + ((v >> 2) & 0x33333333u);
+    v = (v + (v >> 4)) & 0x0F0F0F0Fu;
+    return (v * 0x01010101u) >> 24;
+}
+
+uint8_t CellValue(uint8_t x, uint8_t y)
+{
+    uint16_t k = CELL_INDEX(x,y);
+    return (mineRows[x] & BIT(y)) ? MINE : ADJ_GET(k);
 }
 
 void GenerateMinefield(uint8_t level)
 {
     gameOver = 0;
+    firstClick = 1;
+    gameResult = STATUS_OK;
     timerSeconds = 0;
     timerRunning = 1;
 
@@ -156,121 +425,368 @@ void GenerateMinefield(uint8_t level)
         default:          fieldSize = 5;  mineCount = 5;  break;
     }
 
+    RNG_Seed(HAL_GetTick());
     ClearField();
     ClearOpened();
     PlaceMines();
-
-    for(uint8_t i=0;i<fieldSize;i++)
-        for(uint8_t j=0;j<fieldSize;j++)
-            if(minefield[i][j] != MINE)
-                minefield[i][j] = CountAdjacent(i,j);
+    FindZeroCells();
 }
 
+/* Grows the opened region a whole row at a time: every zero cell in the region
+   opens its row neighbours and the rows above and below, until nothing changes.
+   Uses no queue and no recursion, only freshRows. The sentinel rows and bits
+   are never opened, so rows and edges need no bounds checks. */
 void FloodOpen(uint8_t x, uint8_t y)
 {
-    if(x>=fieldSize || y>=fieldSize) return;
-    if(opened[x][y]) return;
+    for(uint8_t i=0;i<BOARD_STRIDE;i++)
+        freshRows[i] = 0;
 
-    opened[x][y] = 1;
-    openedTotal++;
+    if((openRows[x] | flagRows[x]) & BIT(y)) return;
 
-    if(minefield[x][y] != 0) return;
+    freshRows[x] = BIT(y);
 
-    for(int8_t dx=-1; dx<=1; dx++)
-        for(int8_t dy=-1; dy<=1; dy++)
-            if(dx || dy)
+    uint8_t changed = (zeroRows[x] & BIT(y)) != 0;
+    while(changed)
+    {
+        changed = 0;
+        uint32_t above = 0;
+        uint32_t here  = freshRows[1] & zeroRows[1];
+        for(uint8_t i=1;i<=fieldSize;i++)
+        {
+            uint32_t below = freshRows[i+1] & zeroRows[i+1];
+            uint32_t grow  = ROW_SPREAD(above | here | below) & rowMask & ~(openRows[i] | flagRows[i]);
+            uint32_t next  = freshRows[i] | grow;
+            if(next != freshRows[i])
             {
-                int8_t nx=x+dx, ny=y+dy;
-                if(nx>=0 && ny>=0 && nx<fieldSize && ny<fieldSize)
-                    FloodOpen(nx,ny);
+                freshRows[i] = next;
+                changed = 1;
             }
+            above = freshRows[i] & zeroRows[i];
+            here  = below;
+        }
+    }
+
+    for(uint8_t i=1;i<=fieldSize;i++)
+        openRows[i] |= freshRows[i];
 }
 
-/* ================= RESPONSES ================= */
-void SendError(uint8_t cmd, uint8_t err)
+uint8_t IsBoardCleared(void)
 {
-    txBuf[0]=cmd;
-    txBuf[1]=err;
-    txBuf[2]=0;
-    txBuf[3]=XOR_Checksum(txBuf,3);
-    HAL_UART_Transmit(&huart2,txBuf,4,100);
+    for(uint8_t i=1;i<=fieldSize;i++)
+        if((openRows[i] | mineRows[i]) != rowMask)
+            return 0;
+    return 1;
 }
 
-void SendMinefieldResponse(void)
+/* ================= TX QUEUE ================= */
+/* Safe from any context, including the TIM2 interrupt. Returns 0 if full. */
+uint8_t TX_Enqueue(uint8_t cmd, uint8_t seq, uint8_t status, uint16_t arg)
 {
-    uint16_t idx=0;
-    txBuf[idx++]=CMD_MINEFIELD;
-    txBuf[idx++]=STATUS_OK;
-    txBuf[idx++]=fieldSize*fieldSize;
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
 
-    for(uint8_t i=0;i<fieldSize;i++)
-        for(uint8_t j=0;j<fieldSize;j++)
-            txBuf[idx++] = (minefield[i][j]==MINE)?9:minefield[i][j];
+    if((uint8_t)(txHead - txTail) >= TX_QUEUE_SIZE)
+    {
+        __set_PRIMASK(primask);
+        return 0;
+    }
 
-    txBuf[idx]=XOR_Checksum(txBuf,idx);
-    HAL_UART_Transmit(&huart2,txBuf,idx+1,100);
+    TxFrame *f = &txQueue[txHead & (TX_QUEUE_SIZE-1)];
+    f->cmd = cmd;
+    f->seq = seq;
+    f->status = status;
+    f->arg = arg;
+    txHead++;
+    if(TX_PINS_STATE(cmd)) txPinned++;
+
+    TX_Pump();
+    __set_PRIMASK(primask);
+    return 1;
 }
 
-void SendClickResponse(uint8_t status)
+/* New requests are only parsed once pinned frames are rendered, so a click
+   can not change the board, nor an ECHO its buffer, under a response that
+   is still going out.
+   Bytes keep arriving in rxRing meanwhile. */
+uint8_t TX_CanAccept(void)
 {
-    uint16_t idx=0;
-    txBuf[idx++]=CMD_CLICK;
-    txBuf[idx++]=status;
+    return !txPinned && (uint8_t)(txHead - txTail) < TX_QUEUE_SIZE;
+}
+
+/* Starts DMA on the spare window when the UART is idle and keeps the spare
+   window filled. Runs in the USART2 interrupt or with interrupts masked. */
+void TX_Pump(void)
+{
+    if(!txDmaBusy)
+    {
+        if(!txWinLen[txSpare]) txWinLen[txSpare] = TX_Render(txWin[txSpare]);
+        if(!txWinLen[txSpare]) return;
+
+        /* A refused window stays where it is; UART_Task offers it again */
+        if(HAL_UART_Transmit_DMA(&huart2,txWin[txSpare],txWinLen[txSpare]) != HAL_OK) return;
+        txDmaBusy = 1;
+        txSpare ^= 1;
+        txWinLen[txSpare] = 0;
+    }
+
+    if(!txWinLen[txSpare]) txWinLen[txSpare] = TX_Render(txWin[txSpare]);
+}
+
+/* Forgets every frame, sent or not. HAL_UART_Abort stops the TX DMA without
+   a TxCpltCallback, so nothing else would clear txDmaBusy or unpin the
+   frame it cut, and that frame is garbage at either rate anyway. */
+void TX_Reset(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    txTail = txHead;
+    txFrameLen = 0;
+    txPinned = 0;
+    txWinLen[0] = 0;
+    txWinLen[1] = 0;
+    txDmaBusy = 0;
+
+    __set_PRIMASK(primask);
+}
 
-    uint16_t lenPos = idx++;
-    uint8_t payloadLen = 0;
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+    if(huart->Instance != USART2) return;
+    txDmaBusy = 0;
+    TX_Pump();
+}
 
-    for(uint8_t i=0;i<fieldSize;i++)
-        for(uint8_t j=0;j<fieldSize;j++)
-            if(opened[i][j])
+uint8_t TX_Render(uint8_t *dst)
+{
+    uint8_t n = 0;
+
+    CRC_Load(txCrc);
+    while(n < TX_WINDOW_SIZE && txTail != txHead)
+    {
+        TxFrame *f = &txQueue[txTail & (TX_QUEUE_SIZE-1)];
+
+        if(!txFrameLen) TX_StartFrame(f);
+        dst[n++] = TX_NextByte(f);
+
+        if(++txPos == txFrameLen)
+        {
+            if(TX_PINS_STATE(f->cmd)) txPinned--;
+            txFrameLen = 0;
+            txTail++;
+        }
+    }
+
+    /* Park the running CRC of a frame that continues in the next window,
+       up to and including the window that ends right before its CRC */
+    if(txFrameLen && txPos <= txFrameLen - FRAME_CRC_SIZE) txCrc = CRC_VALUE();
+    return n;
+}
+
+void TX_StartFrame(TxFrame *f)
+{
+    uint16_t len = 0;
+
+    txPos = 0;
+    txCrc = CRC_INIT_VALUE;
+    CRC_Load(txCrc);
+    txRow = 1;
+    txCol = 1;
+
+    /* Error replies carry no payload */
+    switch(f->status == STATUS_ERR ? 0 : f->cmd)
+    {
+        case CMD_MINEFIELD:
+            len = (uint16_t)fieldSize*fieldSize;
+            break;
+        case CMD_NAK:
+        case CMD_STATE:
+            if(!GAME_NONE()) len = (uint16_t)fieldSize*fieldSize;
+            break;
+        case CMD_CLICK:
+            for(uint8_t i=1;i<=fieldSize;i++)
+                len += Popcount32(freshRows[i]);
+            len *= 3;
+            break;
+        case CMD_TIMER:
+            len = 2;
+            break;
+        case CMD_ECHO:
+            len = f->arg;
+            break;
+        case CMD_LINK:
+            len = LINK_ID_SIZE;
+            break;
+    }
+
+    txFrameLen = TX_HEADER_SIZE + len + FRAME_CRC_SIZE;
+}
+
+/* Moves (txRow, txCol) to the next cell opened by the latest click. Never
+   past the last row, even if freshRows no longer holds as many cells as the
+   frame promised. */
+void TX_SeekFresh(void)
+{
+    while(txRow <= fieldSize)
+    {
+        uint32_t m = freshRows[txRow] >> txCol;
+        if(m & 1) return;
+        if(m) txCol++;
+        else { txRow++; txCol = 1; }
+    }
+}
+
+uint8_t TX_NextByte(TxFrame *f)
+{
+    uint16_t len = txFrameLen - TX_HEADER_SIZE - FRAME_CRC_SIZE;
+    uint8_t b;
+
+    if(txPos >= TX_HEADER_SIZE + len)
+    {
+        if(txPos == TX_HEADER_SIZE + len) txCrc = CRC_VALUE();
+        return txCrc >> (8*(txPos - TX_HEADER_SIZE - len));
+    }
+
+    switch(txPos)
+    {
+        case 0:  b = FRAME_SOF;  break;
+        case 1:  b = f->cmd;     break;
+        case 2:  b = f->seq;     break;
+        case 3:  b = f->status;  break;
+        case 4:  b = len & 0xFF; break;
+        case 5:  b = len >> 8;   break;
+        default:
+            if(f->cmd == CMD_ECHO)
             {
-                txBuf[idx++]=i;
-                txBuf[idx++]=j;
-                txBuf[idx++]=(minefield[i][j]==MINE)?9:minefield[i][j];
-                payloadLen+=3;
+                b = echoBuf[txPos - TX_HEADER_SIZE];
             }
+            else if(f->cmd == CMD_TIMER)
+            {
+                /* uint16_t seconds, little-endian */
+                b = (txPos == TX_HEADER_SIZE) ? (f->arg & 0xFF) : (f->arg >> 8);
+            }
+            else if(f->cmd == CMD_MINEFIELD)
+            {
+                b = CellValue(txRow,txCol);
+                if(++txCol > fieldSize) { txCol = 1; txRow++; }
+            }
+            else if(f->cmd == CMD_LINK)
+            {
+                b = linkId[txPos - TX_HEADER_SIZE];
+            }
+            else if(f->cmd == CMD_NAK || f->cmd == CMD_STATE)
+            {
+                /* The board as the PC should show it */
+                if(openRows[txRow] & BIT(txCol))      b = CellValue(txRow,txCol);
+                else if(flagRows[txRow] & BIT(txCol)) b = SNAPSHOT_FLAG;
+                else                                  b = SNAPSHOT_CLOSED;
+                if(++txCol > fieldSize) { txCol = 1; txRow++; }
+            }
+            else
+            {
+                /* (row, col, value) per opened cell */
+                uint8_t part = (txPos - TX_HEADER_SIZE) % 3;
+                if(part == 0) TX_SeekFresh();
+                if(part == 0)      b = txRow - 1;
+                else if(part == 1) b = txCol - 1;
+                else             { b = CellValue(txRow,txCol); txCol++; }
+            }
+            break;
+    }
+
+    CRC_PUT(b);
+    return b;
+}
+
+/* ================= RESPONSES ================= */
+void SendError(uint8_t cmd, uint8_t err)
+{
+    TX_Enqueue(cmd,replySeq,err,0);
+}
+
+void SendMinefieldResponse(void)
+{
+    TX_Enqueue(CMD_MINEFIELD,replySeq,STATUS_OK,0);
+}
 
-    txBuf[lenPos]=payloadLen;
-    txBuf[idx]=XOR_Checksum(txBuf,idx);
-    HAL_UART_Transmit(&huart2,txBuf,idx+1,100);
+void SendClickResponse(uint8_t status)
+{
+    TX_Enqueue(CMD_CLICK,replySeq,status,0);
 }
 
+/* Called from the TIM2 interrupt; if the queue is full this tick is skipped */
 void SendTimer(void)
 {
-    if(!timerRunning) return;
-    char buf[16];
-    int n = sprintf(buf,"T%lu\n",timerSeconds);
-    HAL_UART_Transmit(&huart2,(uint8_t*)buf,n,10);
+    if(!timerRunning || baudPending) return;
+    TX_Enqueue(CMD_TIMER,0,STATUS_OK,timerSeconds);
+}
+
+void SendBaudResponse(uint8_t status)
+{
+    TX_Enqueue(CMD_BAUD,replySeq,status,0);
+}
+
+void SendNakResponse(void)
+{
+    TX_Enqueue(CMD_NAK,replySeq,gameResult,0);
+}
+
+void SendEchoResponse(uint16_t len)
+{
+    TX_Enqueue(CMD_ECHO,replySeq,STATUS_OK,len);
+}
+
+void SendLinkResponse(void)
+{
+    TX_Enqueue(CMD_LINK,replySeq,STATUS_OK,0);
+}
+
+void SendStateResponse(void)
+{
+    TX_Enqueue(CMD_STATE,replySeq,gameResult,0);
 }
 
 /* ================= HANDLERS ================= */
-void HandleMinefield(uint8_t *packet)
+/* Every MINEFIELD and CLICK request gets exactly one reply, an error status
+   included, so the PC can keep several of them in flight */
+void HandleMinefield(uint8_t *payload, uint16_t len)
 {
-    GenerateMinefield(packet[2]);
+    if(len!=1) { SendError(CMD_MINEFIELD, STATUS_ERR); return; }
+    GenerateMinefield(payload[0]);
     SendMinefieldResponse();
 }
 
-void HandleClick(uint8_t *packet)
+void HandleClick(uint8_t *payload, uint16_t len)
 {
-    if(packet[1]!=2 || gameOver) return;
-
-    uint8_t x = packet[2];
-    uint8_t y = packet[3];
-    if(x>=fieldSize || y>=fieldSize) return;
+    if(len!=2 || gameOver ||
+       payload[0]>=fieldSize || payload[1]>=fieldSize)
+    {
+        SendError(CMD_CLICK, STATUS_ERR);
+        return;
+    }
+    uint8_t x = payload[0] + 1;
+    uint8_t y = payload[1] + 1;
 
+    if(firstClick && !(flagRows[x] & BIT(y)))
+    {
+        firstClick = 0;
+        MoveMineFrom(x,y);
+    }
     FloodOpen(x,y);
 
     uint8_t status = STATUS_OK;
 
-    if(minefield[x][y] == MINE)
+    if(openRows[x] & mineRows[x] & BIT(y))
     {
         status = STATUS_LOSE;
+        gameResult = status;
         gameOver = 1;
         timerRunning = 0;
     }
-    else if(openedTotal >= fieldSize*fieldSize - mineCount)
+    else if(IsBoardCleared())
     {
         status = STATUS_WIN;
+        gameResult = status;
         gameOver = 1;
         timerRunning = 0;
     }
@@ -281,49 +797,276 @@ void HandleClick(uint8_t *packet)
 void HandleAbort(void)
 {
     gameOver = 1;
+    gameResult = STATUS_OK;
     timerRunning = 0;
-    openedTotal = 0;
+}
+
+void HandleFlag(uint8_t *payload, uint16_t len)
+{
+    if(len!=2 || gameOver) return;
+
+    if(payload[0]>=fieldSize || payload[1]>=fieldSize) return;
+    uint8_t x = payload[0] + 1;
+    uint8_t y = payload[1] + 1;
+
+    if(!(openRows[x] & BIT(y)))
+        flagRows[x] ^= BIT(y);
+}
+
+/* 4-byte LE rate: switch to it after the reply. Empty payload: the PC
+   confirms the current rate, repeated confirms are harmless. */
+void HandleBaud(uint8_t *payload, uint16_t len)
+{
+    if(len == 0)
+    {
+        baudTrial = 0;
+        SendBaudResponse(STATUS_OK);
+        return;
+    }
+
+    uint32_t baud = 0;
+    if(len == 4)
+        baud = payload[0] | (payload[1] << 8) | ((uint32_t)payload[2] << 16) | ((uint32_t)payload[3] << 24);
+
+    /* 16x oversampling: the USART can not go above PCLK/16 */
+    if(baud < UART_MIN_BAUD || baud > HAL_RCC_GetPCLK1Freq() / 16)
+    {
+        SendBaudResponse(STATUS_ERR);
+        return;
+    }
+
+    SendBaudResponse(STATUS_OK);
+    baudPending = baud;
+}
+
+/* The PC lost the reply to this seq, or never got its request through.
+   Click deltas are not kept, so the answer is the whole board as the PC
+   should show it, flags included, which covers any number of lost frames. */
+void HandleNak(void)
+{
+    SendNakResponse();
+}
+
+/* Link test: the payload comes straight back, so the PC can time round
+   trips and check every byte that crossed the wire both ways */
+void HandleEcho(uint8_t *payload, uint16_t len)
+{
+    if(len > ECHO_MAX_PAYLOAD) { SendError(CMD_ECHO, STATUS_ERR); return; }
+    memcpy(echoBuf, payload, len);
+    SendEchoResponse(len);
+}
+
+/* Handshake for a PC probing its ports. It always arrives at UART_DEFAULT_BAUD;
+   if a reconnecting PC finds us still on a faster rate, its bytes are framing
+   errors and the link falls back before the next retry. */
+void HandleLink(void)
+{
+    SendLinkResponse();
+}
+
+/* A PC that lost the port asks where the game stands. The answer is a NAK
+   snapshot under a fresh seq; it is empty when no game is running. */
+void HandleState(void)
+{
+    SendStateResponse();
 }
 
 /* ================= PACKET ================= */
-void ProcessPacket(uint8_t *packet, uint8_t totalLen)
+/* Called by RX_Feed with a complete frame whose CRC already matched */
+void ProcessPacket(uint8_t *packet, uint16_t totalLen)
 {
-    uint8_t payloadLen = packet[1];
-    uint8_t chkIndex = payloadLen + 2;
+    uint16_t payloadLen = packet[3] | (packet[4] << 8);
+    uint8_t *payload = packet + RX_HEADER_SIZE;
+
+    if(totalLen != payloadLen + RX_HEADER_SIZE + FRAME_CRC_SIZE) return;
 
-    if(totalLen != payloadLen + 3) return;
-    if(packet[chkIndex] != XOR_Checksum(packet, chkIndex)) return;
+    replySeq = packet[2];
 
-    switch(packet[0])
+    switch(packet[1])
     {
-        case CMD_MINEFIELD: HandleMinefield(packet); break;
-        case CMD_CLICK:     HandleClick(packet);     break;
+        case CMD_MINEFIELD: HandleMinefield(payload, payloadLen); break;
+        case CMD_CLICK:     HandleClick(payload, payloadLen);     break;
         case CMD_ABORT:     HandleAbort();           break;
-        default:            SendError(packet[0], STATUS_ERR);
+        case CMD_FLAG:      HandleFlag(payload, payloadLen); break;
+        case CMD_BAUD:      HandleBaud(payload, payloadLen); break;
+        case CMD_NAK:       HandleNak();             break;
+        case CMD_ECHO:      HandleEcho(payload, payloadLen); break;
+        case CMD_LINK:      HandleLink();            break;
+        case CMD_STATE:     HandleState();           break;
+        default:            SendError(packet[1], STATUS_ERR);
     }
 }
 
 /* ================= UART ================= */
+/* Main loop only: the read position is reset along with the DMA */
+void UART_StartReceive(void)
+{
+    HAL_UART_AbortReceive(&huart2);
+    rxRestart = 0;
+    rxLaps = 0;
+    rxWritten = 0;
+    rxRead = 0;
+    HAL_UART_Receive_DMA(&huart2,rxRing,RX_RING_SIZE);
+}
+
+/* Circular RX DMA wrapped: one more lap of rxRing written */
+void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
+{
+    if(huart->Instance == USART2) rxLaps++;
+}
+
+/* Bytes the DMA has written since UART_StartReceive */
+uint32_t RX_Written(void)
+{
+    uint32_t laps = rxLaps;
+    uint16_t head = (RX_RING_SIZE - __HAL_DMA_GET_COUNTER(huart2.hdmarx)) & (RX_RING_SIZE-1);
+    uint32_t written = laps * RX_RING_SIZE + head;
+
+    /* The counter reloads a moment before the wrap interrupt counts the lap */
+    if((int32_t)(written - rxWritten) < 0) written += RX_RING_SIZE;
+    rxWritten = written;
+    return written;
+}
+
+/* Reprograms USART2. TIM2 is held off so no TIMER frame can start on the
+   old rate and be cut by the abort. A switch to an agreed rate waits for TX
+   to go idle; a fallback does not, and drops what was still going out. */
+void UART_SetBaud(uint32_t baud)
+{
+    HAL_NVIC_DisableIRQ(TIM2_IRQn);
+
+    HAL_UART_Abort(&huart2);
+    TX_Reset();
+    huart2.Init.BaudRate = baud;
+    HAL_UART_Init(&huart2);
+
+    rxIndex = 0;
+    baudFailed = 0;
+    UART_StartReceive();
+
+    HAL_NVIC_EnableIRQ(TIM2_IRQn);
+}
+
+/* Any UART error can make the HAL stop the RX DMA, so UART_Task starts it
+   again; the main loop owns the read position. Off the default rate an
+   error means the two ends disagree, so BAUD_Task falls back. */
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+    if(huart->Instance != USART2) return;
+    if(huart->Init.BaudRate != UART_DEFAULT_BAUD) baudFailed = 1;
+    rxRestart = 1;
+}
+
+/* Removes n bytes and any garbage up to the next FRAME_SOF */
+void RX_Drop(uint16_t n)
+{
+    while(n < rxIndex && rxBuf[n] != FRAME_SOF) n++;
+    rxIndex -= n;
+    memmove(rxBuf, rxBuf + n, rxIndex);
+}
+
+/* Takes one byte into rxBuf. Bytes before a FRAME_SOF are skipped. */
+void RX_Feed(uint8_t b)
+{
+    if(!rxIndex && b != FRAME_SOF) return;
+    rxBuf[rxIndex++] = b;
+    RX_Parse();
+}
+
+/* Frame parser. A bad length or CRC drops only the SOF and parsing restarts
+   at the next byte, so one corrupt byte costs at most one frame instead of
+   the rest of the stream. That rescan can find several whole frames in
+   rxBuf at once; they are handled one at a time, only while TX_CanAccept(),
+   and the rest wait in rxBuf for UART_Task. */
+void RX_Parse(void)
+{
+    while(rxIndex >= RX_HEADER_SIZE && !baudPending && TX_CanAccept())
+    {
+        uint16_t totalLen = (rxBuf[3] | (rxBuf[4] << 8)) + RX_HEADER_SIZE + FRAME_CRC_SIZE;
+
+        if(totalLen > RX_BUFFER_SIZE) { RX_Drop(1); continue; }
+        if(rxIndex < totalLen) return;
+
+        uint16_t bodyLen = totalLen - FRAME_CRC_SIZE;
+        uint32_t crc = rxBuf[bodyLen] | (rxBuf[bodyLen+1] << 8) |
+                       ((uint32_t)rxBuf[bodyLen+2] << 16) | ((uint32_t)rxBuf[bodyLen+3] << 24);
+
+        if(crc == CRC_Frame(rxBuf, bodyLen))
+        {
+            ProcessPacket(rxBuf,totalLen);
+            RX_Drop(totalLen);
+        }
+        else RX_Drop(1);
+    }
+}
+
+/* Drains whatever the DMA has written since the last call, never blocks.
+   Stops early while TX_CanAccept() holds requests back, frames already in
+   rxBuf first. A partial frame times out only once the ring is empty, as
+   its rest may be waiting there. If the DMA laps the
+   reader meanwhile, the unread bytes are a mix of two laps: they are all
+   dropped, the partial frame too, and parsing resyncs on the next SOF. */
 void UART_Task(void)
 {
-    uint8_t b;
-    if(HAL_UART_Receive(&huart2,&b,1,HAL_MAX_DELAY) == HAL_OK)
+    if(rxRestart)
     {
-        rxBuf[rxIndex++] = b;
+        rxIndex = 0;
+        UART_StartReceive();
+    }
+
+    /* A window HAL_UART_Transmit_DMA turned away */
+    if(!txDmaBusy && txWinLen[txSpare])
+    {
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        TX_Pump();
+        __set_PRIMASK(primask);
+    }
 
-        if(rxIndex >= 3)
+    RX_Parse();
+    while(!baudPending && TX_CanAccept())
+    {
+        /* Read first: if the DMA is not a ring ahead afterwards, b is intact */
+        uint8_t b = rxRing[rxRead & (RX_RING_SIZE-1)];
+        uint32_t written = RX_Written();
+
+        if(written == rxRead)
         {
-            uint8_t totalLen = rxBuf[1] + 3;
-            if(rxIndex == totalLen)
-            {
-                ProcessPacket(rxBuf,totalLen);
-                rxIndex = 0;
-            }
-            else if(rxIndex > totalLen)
+            if(rxIndex && HAL_GetTick() - rxLastTick > RX_FRAME_TIMEOUT)
                 rxIndex = 0;
+            break;
+        }
+        if(written - rxRead > RX_RING_SIZE)
+        {
+            rxRead = written;
+            rxIndex = 0;
+            rxOverruns++;
+            continue;
         }
 
-        if(rxIndex >= RX_BUFFER_SIZE) rxIndex = 0;
+        rxRead++;
+        RX_Feed(b);
+        rxLastTick = HAL_GetTick();
+    }
+}
+
+/* Applies an agreed rate once its reply is fully on the wire, and falls
+   back to the default when the trial fails */
+void BAUD_Task(void)
+{
+    if(baudPending && txTail == txHead && !txDmaBusy &&
+       __HAL_UART_GET_FLAG(&huart2, UART_FLAG_TC))
+    {
+        UART_SetBaud(baudPending);
+        baudPending = 0;
+        baudTrial = 1;
+        baudTrialTick = HAL_GetTick();
+    }
+
+    if(baudFailed || (baudTrial && HAL_GetTick() - baudTrialTick > BAUD_CONFIRM_TIMEOUT))
+    {
+        baudTrial = 0;
+        UART_SetBaud(UART_DEFAULT_BAUD);
     }
 }
 
@@ -332,7 +1075,7 @@ void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
 {
     if(htim->Instance == TIM2 && timerRunning)
     {
-        timerSeconds++;
+        if(timerSeconds < 0xFFFF) timerSeconds++;
         SendTimer();
     }
 }
@@ -343,15 +1086,19 @@ int main(void)
     HAL_Init();
     SystemClock_Config();
     MX_GPIO_Init();
+    MX_DMA_Init();
     MX_USART2_UART_Init();
     MX_TIM2_Init();
+    MX_CRC_Init();
 
     HAL_TIM_Base_Start_IT(&htim2);
     RNG_Init();
+    UART_StartReceive();
 
     while(1)
     {
         UART_Task();
+        BAUD_Task();
     }
 }
 
@@ -361,12 +1108,28 @@ void SystemClock_Config(void)
     RCC_OscInitTypeDef RCC_OscInitStruct={0};
     RCC_ClkInitTypeDef RCC_ClkInitStruct={0};
 
+    /* HSI/2 x12 = 48 MHz, the most the F0 runs at and what lets USART2 reach 3 Mbaud */
     RCC_OscInitStruct.OscillatorType=RCC_OSCILLATORTYPE_HSI;
     RCC_OscInitStruct.HSIState=RCC_HSI_ON;
+    RCC_OscInitStruct.HSICalibrationValue=RCC_HSICALIBRATION_DEFAULT;
+    RCC_OscInitStruct.PLL.PLLState=RCC_PLL_ON;
+    RCC_OscInitStruct.PLL.PLLSource=RCC_PLLSOURCE_HSI;
+    RCC_OscInitStruct.PLL.PLLMUL=RCC_PLL_MUL12;
+    RCC_OscInitStruct.PLL.PREDIV=RCC_PREDIV_DIV1;
+
+    RCC_ClkInitStruct.ClockType=RCC_CLOCKTYPE_HCLK|RCC_CLOCKTYPE_SYSCLK|RCC_CLOCKTYPE_PCLK1;
+    RCC_ClkInitStruct.SYSCLKSource=RCC_SYSCLKSOURCE_PLLCLK;
+    RCC_ClkInitStruct.AHBCLKDivider=RCC_SYSCLK_DIV1;
+    RCC_ClkInitStruct.APB1CLKDivider=RCC_HCLK_DIV1;
+
+    if(HAL_RCC_OscConfig(&RCC_OscInitStruct) == HAL_OK &&
+       HAL_RCC_ClockConfig(&RCC_ClkInitStruct,FLASH_LATENCY_1) == HAL_OK)
+        return;
+
+    /* PLL did not lock: stay on the bare 8 MHz HSI, BAUD requests are capped to match */
     RCC_OscInitStruct.PLL.PLLState=RCC_PLL_NONE;
     HAL_RCC_OscConfig(&RCC_OscInitStruct);
 
-    RCC_ClkInitStruct.ClockType=RCC_CLOCKTYPE_HCLK|RCC_CLOCKTYPE_SYSCLK|RCC_CLOCKTYPE_PCLK1;
     RCC_ClkInitStruct.SYSCLKSource=RCC_SYSCLKSOURCE_HSI;
     HAL_RCC_ClockConfig(&RCC_ClkInitStruct,FLASH_LATENCY_0);
 }
@@ -374,7 +1137,7 @@ void SystemClock_Config(void)
 static void MX_USART2_UART_Init(void)
 {
     huart2.Instance=USART2;
-    huart2.Init.BaudRate=115200;
+    huart2.Init.BaudRate=UART_DEFAULT_BAUD;
     huart2.Init.WordLength=UART_WORDLENGTH_8B;
     huart2.Init.StopBits=UART_STOPBITS_1;
     huart2.Init.Parity=UART_PARITY_NONE;
@@ -387,15 +1150,30 @@ static void MX_GPIO_Init(void)
     __HAL_RCC_GPIOA_CLK_ENABLE();
 }
 
+static void MX_DMA_Init(void)
+{
+    __HAL_RCC_DMA1_CLK_ENABLE();
+    HAL_NVIC_SetPriority(DMA1_Channel4_5_IRQn, 0, 0);
+    HAL_NVIC_EnableIRQ(DMA1_Channel4_5_IRQn);
+}
+
 static void MX_TIM2_Init(void)
 {
     htim2.Instance = TIM2;
-    htim2.Init.Prescaler = 8000-1;
+    htim2.Init.Prescaler = HAL_RCC_GetPCLK1Freq()/1000 - 1;  /* 1 kHz tick whatever the clock */
     htim2.Init.CounterMode = TIM_COUNTERMODE_UP;
     htim2.Init.Period = 1000-1;
     HAL_TIM_Base_Init(&htim2);
 }
 
+/* Reset configuration: CRC-32/MPEG-2, no input or output reversal */
+static void MX_CRC_Init(void)
+{
+    __HAL_RCC_CRC_CLK_ENABLE();
+    CRC->CR = 0;
+    CRC_Load(CRC_INIT_VALUE);
+}
+
 void Error_Handler(void)
 {
     __disable_irq();
@@ -0,0 +1,107 @@
+/**
+  ******************************************************************************
+  * @file    baseline.c
+  * @brief   Original board logic, kept as the benchmarks' point of reference.
+  *          Only MAX_SIZE and the depth counter differ from the first
+  *          firmware.
+  ******************************************************************************
+  */
+
+#include "baseline.h"
+#include <stdlib.h>
+#include <string.h>
+
+int8_t  baseField[BASELINE_MAX_SIZE][BASELINE_MAX_SIZE];
+uint8_t baseOpened[BASELINE_MAX_SIZE][BASELINE_MAX_SIZE];
+uint8_t baseSize = 0;
+uint16_t baseOpenedTotal = 0;
+uint16_t baseDepthMax = 0;
+static uint16_t depth = 0;
+
+/* The firmware's board, read through its bit planes */
+extern uint8_t fieldSize;
+extern uint32_t mineRows[];
+
+void Baseline_ClearOpened(void)
+{
+    baseOpenedTotal = 0;
+    baseDepthMax = 0;
+    for(uint8_t i=0;i<baseSize;i++)
+        for(uint8_t j=0;j<baseSize;j++)
+            baseOpened[i][j] = 0;
+}
+
+void Baseline_PlaceMines(uint8_t size, uint16_t mines)
+{
+    baseSize = size;
+    for(uint8_t i=0;i<baseSize;i++)
+        for(uint8_t j=0;j<baseSize;j++)
+            baseField[i][j] = 0;
+
+    uint16_t placed = 0;
+    while(placed < mines)
+    {
+        uint8_t x = rand() % baseSize;
+        uint8_t y = rand() % baseSize;
+        if(baseField[x][y] != BASELINE_MINE)
+        {
+            baseField[x][y] = BASELINE_MINE;
+            placed++;
+        }
+    }
+}
+
+uint8_t Baseline_CountAdjacent(uint8_t x, uint8_t y)
+{
+    uint8_t cnt = 0;
+    for(int8_t dx=-1; dx<=1; dx++)
+        for(int8_t dy=-1; dy<=1; dy++)
+        {
+            if(!dx && !dy) continue;
+            int8_t nx = x + dx;
+            int8_t ny = y + dy;
+            if(nx>=0 && ny>=0 && nx<baseSize && ny<baseSize)
+                if(baseField[nx][ny] == BASELINE_MINE)
+                    cnt++;
+        }
+    return cnt;
+}
+
+void Baseline_LoadBoard(void)
+{
+    baseSize = fieldSize;
+    for(uint8_t i=0;i<baseSize;i++)
+        for(uint8_t j=0;j<baseSize;j++)
+            baseField[i][j] = (mineRows[i+1] >> (j+1)) & 1 ? BASELINE_MINE : 0;
+    Baseline_CountAll();
+}
+
+void Baseline_CountAll(void)
+{
+    for(uint8_t i=0;i<baseSize;i++)
+        for(uint8_t j=0;j<baseSize;j++)
+            if(baseField[i][j] != BASELINE_MINE)
+                baseField[i][j] = Baseline_CountAdjacent(i,j);
+}
+
+void Baseline_FloodOpen(uint8_t x, uint8_t y)
+{
+    if(x>=baseSize || y>=baseSize) return;
+    if(baseOpened[x][y]) return;
+
+    baseOpened[x][y] = 1;
+    baseOpenedTotal++;
+
+    if(baseField[x][y] != 0) return;
+
+    if(++depth > baseDepthMax) baseDepthMax = depth;
+    for(int8_t dx=-1; dx<=1; dx++)
+        for(int8_t dy=-1; dy<=1; dy++)
+            if(dx || dy)
+            {
+                int8_t nx=x+dx, ny=y+dy;
+                if(nx>=0 && ny>=0 && nx<baseSize && ny<baseSize)
+                    Baseline_FloodOpen(nx,ny);
+            }
+    depth--;
+}
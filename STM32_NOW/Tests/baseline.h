@@ -0,0 +1,35 @@
+/**
+  ******************************************************************************
+  * @file    baseline.h
+  * @brief   The board logic as the firmware first shipped it: a byte per
+  *          cell, bounds checks on every neighbour, recursive flood fill.
+  *          Benchmarks run it next to main.c on the same boards.
+  ******************************************************************************
+  */
+
+#ifndef __BASELINE_H
+#define __BASELINE_H
+
+#include <stdint.h>
+
+#define BASELINE_MAX_SIZE 30
+#define BASELINE_MINE     -1
+
+extern int8_t  baseField[BASELINE_MAX_SIZE][BASELINE_MAX_SIZE];
+extern uint8_t baseOpened[BASELINE_MAX_SIZE][BASELINE_MAX_SIZE];
+extern uint8_t baseSize;
+extern uint16_t baseOpenedTotal;
+/* Deepest FloodOpen nesting since Baseline_ClearOpened */
+extern uint16_t baseDepthMax;
+
+/* Takes over the mines of the firmware board and counts around them */
+void Baseline_LoadBoard(void);
+void Baseline_ClearOpened(void);
+/* Empties a size x size board and places mines by rejection sampling */
+void Baseline_PlaceMines(uint8_t size, uint16_t mines);
+uint8_t Baseline_CountAdjacent(uint8_t x, uint8_t y);
+/* Fills in the count of every cell that is not a mine */
+void Baseline_CountAll(void);
+void Baseline_FloodOpen(uint8_t x, uint8_t y);
+
+#endif /* __BASELINE_H */
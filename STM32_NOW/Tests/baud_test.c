@@ -0,0 +1,157 @@
+/**
+  ******************************************************************************
+  * @file    baud_test.c
+  * @brief   Rate changes with TX busy: the fallback after a UART error or an
+  *          unconfirmed trial aborts a frame mid-window, and the link must
+  *          keep answering afterwards. Also a TX DMA start that the HAL
+  *          turns away.
+  ******************************************************************************
+  */
+
+#include "firmware.h"
+
+#define TRIAL_BAUD 1000000
+
+static uint32_t replyAt = 0;
+
+static void SendEcho(uint8_t seq, uint16_t len)
+{
+    uint8_t p[ECHO_MAX_PAYLOAD];
+    for(uint16_t i=0;i<len;i++) p[i] = (uint8_t)(seq * 7 + i);
+    Test_Send(CMD_ECHO, seq, p, len);
+}
+
+static void ExpectEcho(uint8_t seq, uint16_t len)
+{
+    Reply r;
+    CHECK(Test_NextReply(&replyAt, &r));
+    CHECK(r.cmd == CMD_ECHO && r.seq == seq && r.status == STATUS_OK && r.len == len);
+    for(uint16_t i=0;i<len;i++)
+        CHECK(r.payload[i] == (uint8_t)(seq * 7 + i));
+}
+
+static void ExpectNoReply(void)
+{
+    Reply r;
+    CHECK(!Test_NextReply(&replyAt, &r));
+}
+
+/* Every reply so far is dropped from the log */
+static void ClearReplies(void)
+{
+    Host_TxClear();
+    replyAt = 0;
+}
+
+static void StartTrial(uint8_t seq)
+{
+    uint8_t p[4] = { TRIAL_BAUD & 0xFF, (TRIAL_BAUD >> 8) & 0xFF, (TRIAL_BAUD >> 16) & 0xFF, TRIAL_BAUD >> 24 };
+    Test_Send(CMD_BAUD, seq, p, 4);
+    Test_Run();
+
+    Reply r;
+    CHECK(Test_NextReply(&replyAt, &r));
+    CHECK(r.cmd == CMD_BAUD && r.seq == seq && r.status == STATUS_OK);
+    CHECK(hostBaud == TRIAL_BAUD && baudTrial && !baudPending);
+    ClearReplies();
+}
+
+/* A HARD board is longer than both TX windows: after one UART_Task a window
+   is on the wire and the frame still pins the parser */
+static void StartBoard(uint8_t seq)
+{
+    uint8_t level = DIFF_HARD;
+    Test_Send(CMD_MINEFIELD, seq, &level, 1);
+    UART_Task();
+    CHECK(Host_TxInFlight() && txDmaBusy && txPinned);
+}
+
+/* Back on the default rate with TX idle, and requests answered again */
+static void ExpectRecovered(uint8_t seq)
+{
+    CHECK(hostBaud == UART_DEFAULT_BAUD && !baudTrial && !baudFailed);
+    CHECK(!Host_TxInFlight() && !txDmaBusy && !txPinned && txTail == txHead);
+
+    ClearReplies();
+    for(uint8_t i=0;i<3;i++) SendEcho(seq + i, 90);
+    Test_Run();
+    for(uint8_t i=0;i<3;i++) ExpectEcho(seq + i, 90);
+    ExpectNoReply();
+}
+
+static void TestErrorFallback(void)
+{
+    StartTrial(1);
+    StartBoard(2);
+
+    HAL_UART_ErrorCallback(&huart2);
+    BAUD_Task();
+    ExpectRecovered(3);
+    printf("UART error on trial with a frame on the wire: link recovered\n");
+}
+
+static void TestTimeoutFallback(void)
+{
+    StartTrial(10);
+    StartBoard(11);
+
+    hostTick += BAUD_CONFIRM_TIMEOUT + 1;
+    BAUD_Task();
+    ExpectRecovered(12);
+    printf("unconfirmed trial with a frame on the wire: link recovered\n");
+}
+
+/* The agreed switch itself waits for TX, so nothing is dropped */
+static void TestConfirmedSwitch(void)
+{
+    StartTrial(20);
+    Test_Send(CMD_BAUD, 21, NULL, 0);
+    SendEcho(22, 120);
+    Test_Run();
+
+    Reply r;
+    CHECK(Test_NextReply(&replyAt, &r));
+    CHECK(r.cmd == CMD_BAUD && r.seq == 21 && r.status == STATUS_OK);
+    ExpectEcho(22, 120);
+    ExpectNoReply();
+    CHECK(hostBaud == TRIAL_BAUD && !baudTrial);
+
+    /* Back down through the pending path, with the reply to BAUD still in a
+       window while it is parsed */
+    uint8_t p[4] = { UART_DEFAULT_BAUD & 0xFF, (UART_DEFAULT_BAUD >> 8) & 0xFF, UART_DEFAULT_BAUD >> 16, 0 };
+    ClearReplies();
+    Test_Send(CMD_BAUD, 23, p, 4);
+    UART_Task();
+    BAUD_Task();
+    CHECK(baudPending && hostBaud == TRIAL_BAUD);
+    Test_Run();
+    CHECK(Test_NextReply(&replyAt, &r) && r.seq == 23);
+    /* The confirm goes out at the new rate */
+    Test_Send(CMD_BAUD, 25, NULL, 0);
+    Test_Run();
+    CHECK(Test_NextReply(&replyAt, &r) && r.seq == 25);
+    ExpectRecovered(26);
+    printf("confirmed switch and back: every reply sent\n");
+}
+
+static void TestRefusedTransmit(void)
+{
+    ClearReplies();
+    hostTxRefuse = 3;
+    SendEcho(30, 200);
+    Test_Run();
+    CHECK(!hostTxRefuse);
+    ExpectEcho(30, 200);
+    ExpectNoReply();
+    printf("refused TX DMA start: window sent on retry\n");
+}
+
+int main(void)
+{
+    Test_Init();
+    TestErrorFallback();
+    TestTimeoutFallback();
+    TestConfirmedSwitch();
+    TestRefusedTransmit();
+    return 0;
+}
@@ -0,0 +1,96 @@
+/**
+  ******************************************************************************
+  * @file    firmware.h
+  * @brief   Pulls Core/Src/main.c into a host test, statics included. Its
+  *          main() is renamed so the test brings its own.
+  ******************************************************************************
+  */
+
+#ifndef __FIRMWARE_H
+#define __FIRMWARE_H
+
+#define main firmware_main
+#include "../Core/Src/main.c"
+#undef main
+
+#include "hal_host.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Fails the test with the line that caught it */
+#define CHECK(c) do { if(!(c)) { printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #c); exit(1); } } while(0)
+
+/* ================= FRAMES ================= */
+/* The PC's side of the link */
+typedef struct
+{
+    uint8_t cmd;
+    uint8_t seq;
+    uint8_t status;
+    uint16_t len;
+    const uint8_t *payload;     /* into hostTxLog */
+} Reply;
+
+/* Puts one PC->MCU frame on the wire */
+static inline void Test_Send(uint8_t cmd, uint8_t seq, const uint8_t *payload, uint16_t len)
+{
+    uint8_t f[RX_BUFFER_SIZE];
+    CHECK(len + RX_HEADER_SIZE + FRAME_CRC_SIZE <= RX_BUFFER_SIZE);
+
+    f[0] = FRAME_SOF;
+    f[1] = cmd;
+    f[2] = seq;
+    f[3] = len & 0xFF;
+    f[4] = len >> 8;
+    if(len) memcpy(f + RX_HEADER_SIZE, payload, len);
+    uint32_t crc = Host_Crc(CRC_INIT_VALUE, f, RX_HEADER_SIZE + len);
+    for(uint8_t i=0;i<FRAME_CRC_SIZE;i++)
+        f[RX_HEADER_SIZE + len + i] = crc >> (8*i);
+
+    Host_RxWrite(f, RX_HEADER_SIZE + len + FRAME_CRC_SIZE);
+}
+
+/* Reads the MCU->PC frame at *at in hostTxLog; 0 when there is none. A
+   frame that is not well formed or fails its CRC fails the test. */
+static inline uint8_t Test_NextReply(uint32_t *at, Reply *r)
+{
+    const uint8_t *f = hostTxLog + *at;
+    if(*at >= hostTxLen) return 0;
+
+    CHECK(hostTxLen - *at >= TX_HEADER_SIZE + FRAME_CRC_SIZE && f[0] == FRAME_SOF);
+    r->cmd = f[1];
+    r->seq = f[2];
+    r->status = f[3];
+    r->len = f[4] | (f[5] << 8);
+    r->payload = f + TX_HEADER_SIZE;
+    CHECK(hostTxLen - *at >= (uint32_t)TX_HEADER_SIZE + r->len + FRAME_CRC_SIZE);
+
+    const uint8_t *c = r->payload + r->len;
+    uint32_t crc = c[0] | (c[1] << 8) | ((uint32_t)c[2] << 16) | ((uint32_t)c[3] << 24);
+    CHECK(crc == Host_Crc(CRC_INIT_VALUE, f, TX_HEADER_SIZE + r->len));
+
+    *at += TX_HEADER_SIZE + r->len + FRAME_CRC_SIZE;
+    return 1;
+}
+
+/* What main() does before its loop, minus the clocks */
+static inline void Test_Init(void)
+{
+    MX_USART2_UART_Init();
+    MX_CRC_Init();
+    UART_StartReceive();
+    Host_TxClear();
+}
+
+/* The main loop with TX interrupts served, until everything has settled */
+static inline void Test_Run(void)
+{
+    for(uint8_t i=0;i<64;i++)
+    {
+        UART_Task();
+        Host_TxRun();
+        BAUD_Task();
+    }
+}
+
+#endif /* __FIRMWARE_H */
@@ -0,0 +1,86 @@
+/**
+  ******************************************************************************
+  * @file    flood_bench.c
+  * @brief   FloodOpen against the original recursion: every cell of many
+  *          boards of each preset is clicked on a fresh board by both, the
+  *          cells they open must match, and both are timed.
+  ******************************************************************************
+  */
+
+#include "firmware.h"
+#include "baseline.h"
+
+#define BOARDS 2000
+
+static uint16_t Revealed(void)
+{
+    uint16_t n = 0;
+    for(uint8_t i=1;i<=fieldSize;i++)
+        n += Popcount32(freshRows[i]);
+    return n;
+}
+
+static void Bench(const char *name, uint8_t level)
+{
+    double fwTime = 0, baseTime = 0;
+    uint32_t cells = 0, clicks = 0;
+    uint16_t depthMax = 0;
+
+    for(uint32_t b=0;b<BOARDS;b++)
+    {
+        hostTick = b * 7919u;
+        GenerateMinefield(level);
+        Baseline_LoadBoard();
+
+        /* Timed passes first, one click per cell on a fresh board each time */
+        double t0 = Host_Seconds();
+        for(uint8_t x=0;x<fieldSize;x++)
+            for(uint8_t y=0;y<fieldSize;y++)
+            {
+                ClearOpened();
+                FloodOpen(x+1,y+1);
+            }
+        double t1 = Host_Seconds();
+        for(uint8_t x=0;x<fieldSize;x++)
+            for(uint8_t y=0;y<fieldSize;y++)
+            {
+                Baseline_ClearOpened();
+                Baseline_FloodOpen(x,y);
+                if(baseDepthMax > depthMax) depthMax = baseDepthMax;
+            }
+        double t2 = Host_Seconds();
+        fwTime += t1 - t0;
+        baseTime += t2 - t1;
+
+        /* Then the same clicks again, compared cell by cell */
+        for(uint8_t x=0;x<fieldSize;x++)
+            for(uint8_t y=0;y<fieldSize;y++)
+            {
+                ClearOpened();
+                FloodOpen(x+1,y+1);
+                Baseline_ClearOpened();
+                Baseline_FloodOpen(x,y);
+
+                uint16_t n = Revealed();
+                CHECK(n == baseOpenedTotal);
+                for(uint8_t i=0;i<fieldSize;i++)
+                    for(uint8_t j=0;j<fieldSize;j++)
+                        CHECK(!!(openRows[i+1] & BIT(j+1)) == baseOpened[i][j]);
+
+                cells += n;
+                clicks++;
+            }
+    }
+
+    printf("%-6s %7u clicks %8u cells | recursion %6.1f Mcells/s, depth up to %3u | FloodOpen %6.1f Mcells/s (x%.1f)\n",
+           name, clicks, cells, cells / baseTime / 1e6, depthMax, cells / fwTime / 1e6, baseTime / fwTime);
+}
+
+int main(void)
+{
+    printf("FloodOpen keeps its whole state in freshRows, %u bytes\n", (unsigned)sizeof(freshRows));
+    Bench("EASY", DIFF_EASY);
+    Bench("MEDIUM", DIFF_MEDIUM);
+    Bench("HARD", DIFF_HARD);
+    return 0;
+}
@@ -0,0 +1,203 @@
+/**
+  ******************************************************************************
+  * @file    hal_host.c
+  * @brief   Host models of the HAL calls and peripherals main.c uses: the CRC
+  *          unit, USART2 with its RX and TX DMA, the tick and the clocks.
+  *          Interrupts never fire on their own; tests call the callbacks.
+  ******************************************************************************
+  */
+
+#define _POSIX_C_SOURCE 199309L
+#include "main.h"
+#include "hal_host.h"
+#include <string.h>
+#include <time.h>
+
+USART_TypeDef usart2Regs;
+TIM_TypeDef tim2Regs;
+CRC_TypeDef crcRegs;
+USART_TypeDef *USART2 = &usart2Regs;
+TIM_TypeDef *TIM2 = &tim2Regs;
+CRC_TypeDef *CRC = &crcRegs;
+
+uint32_t hostTick = 0;
+uint32_t hostBaud = 0;
+
+/* ================= CRC ================= */
+uint32_t Host_Crc(uint32_t crc, const uint8_t *data, size_t len)
+{
+    for(size_t i=0;i<len;i++)
+    {
+        crc ^= (uint32_t)data[i] << 24;
+        for(uint8_t k=0;k<8;k++)
+            crc = (crc & 0x80000000u) ? (crc << 1) ^ 0x04C11DB7u : crc << 1;
+    }
+    return crc;
+}
+
+/* The unit reloads DR from INIT as soon as CR.RESET is written; here the
+   reload happens on the next access */
+static void CrcApplyReset(void)
+{
+    if(CRC->CR & CRC_CR_RESET)
+    {
+        CRC->DR = CRC->INIT;
+        CRC->CR &= ~CRC_CR_RESET;
+    }
+}
+
+void Host_CrcPut(uint8_t b)
+{
+    CrcApplyReset();
+    CRC->DR = Host_Crc(CRC->DR, &b, 1);
+}
+
+uint32_t Host_CrcValue(void)
+{
+    CrcApplyReset();
+    return CRC->DR;
+}
+
+/* ================= USART2 ================= */
+static uint8_t *rxRingAt = NULL;
+static uint16_t rxRingSize = 0;
+uint32_t hostRxWritten = 0;
+uint8_t hostRxLapHeld = 0;
+static uint32_t rxLapsHeld = 0;
+
+static const uint8_t *txData = NULL;
+static uint16_t txSize = 0;
+uint8_t hostTxLog[1 << 20];
+uint32_t hostTxLen = 0;
+uint8_t hostTxRefuse = 0;
+
+extern UART_HandleTypeDef huart2;
+
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef *huart)
+{
+    hostBaud = huart->Init.BaudRate;
+    return HAL_OK;
+}
+
+/* Stops both DMA streams; like the HAL's blocking abort, no callback runs */
+HAL_StatusTypeDef HAL_UART_Abort(UART_HandleTypeDef *huart)
+{
+    (void)huart;
+    txData = NULL;
+    txSize = 0;
+    rxRingAt = NULL;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_AbortReceive(UART_HandleTypeDef *huart)
+{
+    (void)huart;
+    rxRingAt = NULL;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart, const uint8_t *data, uint16_t size)
+{
+    (void)huart;
+    if(txSize) return HAL_BUSY;
+    if(hostTxRefuse) { hostTxRefuse--; return HAL_BUSY; }
+    txData = data;
+    txSize = size;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Receive_DMA(UART_HandleTypeDef *huart, uint8_t *data, uint16_t size)
+{
+    (void)huart;
+    rxRingAt = data;
+    rxRingSize = size;
+    hostRxWritten = 0;
+    rxLapsHeld = 0;
+    return HAL_OK;
+}
+
+uint32_t Host_DmaCounter(void)
+{
+    return rxRingSize ? rxRingSize - hostRxWritten % rxRingSize : 0;
+}
+
+/* TC: the shift register is empty, i.e. no transfer is in flight */
+uint32_t Host_UartFlag(uint32_t flag)
+{
+    return flag == UART_FLAG_TC ? !txSize : 0;
+}
+
+void Host_RxWrite(const uint8_t *data, uint16_t len)
+{
+    if(!rxRingAt) return;
+    for(uint16_t i=0;i<len;i++)
+    {
+        rxRingAt[hostRxWritten++ % rxRingSize] = data[i];
+        if(hostRxWritten % rxRingSize) continue;
+        if(hostRxLapHeld) rxLapsHeld++;
+        else HAL_UART_RxCpltCallback(&huart2);
+    }
+}
+
+void Host_RxLapIrq(void)
+{
+    for(;rxLapsHeld;rxLapsHeld--)
+        HAL_UART_RxCpltCallback(&huart2);
+}
+
+uint32_t Host_TxRun(void)
+{
+    uint32_t sent = 0;
+    while(txSize)
+    {
+        uint16_t n = txSize;
+        if(hostTxLen + n <= sizeof(hostTxLog))
+        {
+            memcpy(hostTxLog + hostTxLen, txData, n);
+            hostTxLen += n;
+        }
+        sent += n;
+        txSize = 0;
+        HAL_UART_TxCpltCallback(&huart2);
+    }
+    return sent;
+}
+
+uint8_t Host_TxInFlight(void)
+{
+    return txSize != 0;
+}
+
+void Host_TxClear(void)
+{
+    hostTxLen = 0;
+}
+
+/* ================= CORE ================= */
+static uint32_t primask = 0;
+
+uint32_t __get_PRIMASK(void) { return primask; }
+void __set_PRIMASK(uint32_t p) { primask = p; }
+void __disable_irq(void) { primask = 1; }
+
+HAL_StatusTypeDef HAL_Init(void) { return HAL_OK; }
+uint32_t HAL_GetTick(void) { return hostTick; }
+
+void HAL_NVIC_SetPriority(IRQn_Type irq, uint32_t pre, uint32_t sub) { (void)irq; (void)pre; (void)sub; }
+void HAL_NVIC_EnableIRQ(IRQn_Type irq) { (void)irq; }
+void HAL_NVIC_DisableIRQ(IRQn_Type irq) { (void)irq; }
+
+HAL_StatusTypeDef HAL_RCC_OscConfig(RCC_OscInitTypeDef *osc) { (void)osc; return HAL_OK; }
+HAL_StatusTypeDef HAL_RCC_ClockConfig(RCC_ClkInitTypeDef *clk, uint32_t latency) { (void)clk; (void)latency; return HAL_OK; }
+uint32_t HAL_RCC_GetPCLK1Freq(void) { return 48000000; }
+
+HAL_StatusTypeDef HAL_TIM_Base_Init(TIM_HandleTypeDef *htim) { (void)htim; return HAL_OK; }
+HAL_StatusTypeDef HAL_TIM_Base_Start_IT(TIM_HandleTypeDef *htim) { (void)htim; return HAL_OK; }
+
+/* ================= TIMING ================= */
+double Host_Seconds(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
@@ -0,0 +1,57 @@
+/**
+  ******************************************************************************
+  * @file    hal_host.h
+  * @brief   What the host tests see of the modelled peripherals
+  ******************************************************************************
+  */
+
+#ifndef __HAL_HOST_H
+#define __HAL_HOST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* HAL_GetTick; tests move it by hand */
+extern uint32_t hostTick;
+
+/* ================= CRC ================= */
+/* Software CRC-32/MPEG-2, what the CRC unit computes from its reset setup */
+uint32_t Host_Crc(uint32_t crc, const uint8_t *data, size_t len);
+
+/* ================= USART2 ================= */
+/* RX DMA writes len bytes into the ring the firmware gave it, wrapping like
+   circular mode does, with HAL_UART_RxCpltCallback at every wrap */
+void Host_RxWrite(const uint8_t *data, uint16_t len);
+
+/* While set, wrap interrupts wait for Host_RxLapIrq, as when the counter
+   has reloaded and the interrupt has not run yet */
+extern uint8_t hostRxLapHeld;
+void Host_RxLapIrq(void);
+
+/* Bytes the RX DMA has written since it was last started */
+extern uint32_t hostRxWritten;
+
+/* Completes TX DMA transfers, each one calling HAL_UART_TxCpltCallback like
+   the transfer-complete interrupt, until the firmware starts no more.
+   Returns the bytes sent. */
+uint32_t Host_TxRun(void);
+
+/* The next hostTxRefuse transfers are turned away with HAL_BUSY, as the
+   HAL does while the handle is not ready */
+extern uint8_t hostTxRefuse;
+
+/* A TX DMA transfer has been started and not completed yet */
+uint8_t Host_TxInFlight(void);
+
+/* Everything sent so far; Host_TxClear forgets it */
+extern uint8_t hostTxLog[1 << 20];
+extern uint32_t hostTxLen;
+void Host_TxClear(void);
+
+/* Rate the UART was last initialised at */
+extern uint32_t hostBaud;
+
+/* ================= TIMING ================= */
+double Host_Seconds(void);
+
+#endif /* __HAL_HOST_H */
@@ -0,0 +1,137 @@
+/**
+  ******************************************************************************
+  * @file    main.h
+  * @brief   Host stand-in for Core/Inc/main.h: just enough of the HAL and
+  *          CMSIS for Core/Src/main.c to build and run on a PC. The
+  *          peripherals behind it are modelled in hal_host.c.
+  ******************************************************************************
+  */
+
+#ifndef __MAIN_H
+#define __MAIN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define __IO volatile
+
+/* ================= TYPES ================= */
+typedef enum { HAL_OK = 0, HAL_ERROR, HAL_BUSY, HAL_TIMEOUT } HAL_StatusTypeDef;
+
+typedef enum { DMA1_Channel4_5_IRQn = 11, TIM2_IRQn = 15, USART2_IRQn = 28 } IRQn_Type;
+
+typedef struct { uint32_t x; } USART_TypeDef;
+typedef struct { uint32_t x; } TIM_TypeDef;
+typedef struct { __IO uint32_t DR; __IO uint32_t IDR; __IO uint32_t CR; uint32_t RESERVED; __IO uint32_t INIT; } CRC_TypeDef;
+
+typedef struct { uint32_t x; } DMA_HandleTypeDef;
+
+typedef struct
+{
+    uint32_t BaudRate, WordLength, StopBits, Parity, Mode, HwFlowCtl, OverSampling;
+} UART_InitTypeDef;
+
+typedef struct
+{
+    USART_TypeDef *Instance;
+    UART_InitTypeDef Init;
+    DMA_HandleTypeDef *hdmatx;
+    DMA_HandleTypeDef *hdmarx;
+} UART_HandleTypeDef;
+
+typedef struct
+{
+    TIM_TypeDef *Instance;
+    struct { uint32_t Prescaler, CounterMode, Period; } Init;
+} TIM_HandleTypeDef;
+
+typedef struct
+{
+    uint32_t OscillatorType, HSIState, HSICalibrationValue;
+    struct { uint32_t PLLState, PLLSource, PLLMUL, PREDIV; } PLL;
+} RCC_OscInitTypeDef;
+
+typedef struct { uint32_t ClockType, SYSCLKSource, AHBCLKDivider, APB1CLKDivider; } RCC_ClkInitTypeDef;
+
+/* ================= PERIPHERALS ================= */
+extern USART_TypeDef *USART2;
+extern TIM_TypeDef *TIM2;
+extern CRC_TypeDef *CRC;
+
+#define CRC_CR_RESET 0x1u
+
+/* The CRC unit recomputes DR on every register write; a host struct can not,
+   so main.c feeds and reads it through these */
+#define CRC_PUT(b)   Host_CrcPut(b)
+#define CRC_VALUE()  Host_CrcValue()
+void Host_CrcPut(uint8_t b);
+uint32_t Host_CrcValue(void);
+
+/* ================= CONSTANTS ================= */
+#define UART_WORDLENGTH_8B 0
+#define UART_STOPBITS_1    0
+#define UART_PARITY_NONE   0
+#define UART_MODE_TX_RX    0x0C
+#define UART_FLAG_TC       0x40
+
+#define TIM_COUNTERMODE_UP 0
+
+#define RCC_OSCILLATORTYPE_HSI     0x2
+#define RCC_HSI_ON                 0x1
+#define RCC_HSICALIBRATION_DEFAULT 0x10
+#define RCC_PLL_NONE               0
+#define RCC_PLL_ON                 2
+#define RCC_PLLSOURCE_HSI          0
+#define RCC_PLL_MUL12              0x280000
+#define RCC_PREDIV_DIV1            0
+#define RCC_CLOCKTYPE_SYSCLK       0x1
+#define RCC_CLOCKTYPE_HCLK         0x2
+#define RCC_CLOCKTYPE_PCLK1        0x4
+#define RCC_SYSCLKSOURCE_HSI       0
+#define RCC_SYSCLKSOURCE_PLLCLK    2
+#define RCC_SYSCLK_DIV1            0
+#define RCC_HCLK_DIV1              0
+#define FLASH_LATENCY_0            0
+#define FLASH_LATENCY_1            1
+
+/* ================= CORE ================= */
+uint32_t __get_PRIMASK(void);
+void __set_PRIMASK(uint32_t primask);
+void __disable_irq(void);
+
+/* ================= HAL ================= */
+HAL_StatusTypeDef HAL_Init(void);
+uint32_t HAL_GetTick(void);
+
+void HAL_NVIC_SetPriority(IRQn_Type irq, uint32_t pre, uint32_t sub);
+void HAL_NVIC_EnableIRQ(IRQn_Type irq);
+void HAL_NVIC_DisableIRQ(IRQn_Type irq);
+
+HAL_StatusTypeDef HAL_RCC_OscConfig(RCC_OscInitTypeDef *osc);
+HAL_StatusTypeDef HAL_RCC_ClockConfig(RCC_ClkInitTypeDef *clk, uint32_t latency);
+uint32_t HAL_RCC_GetPCLK1Freq(void);
+#define __HAL_RCC_GPIOA_CLK_ENABLE() ((void)0)
+#define __HAL_RCC_DMA1_CLK_ENABLE()  ((void)0)
+#define __HAL_RCC_CRC_CLK_ENABLE()   ((void)0)
+
+HAL_StatusTypeDef HAL_TIM_Base_Init(TIM_HandleTypeDef *htim);
+HAL_StatusTypeDef HAL_TIM_Base_Start_IT(TIM_HandleTypeDef *htim);
+
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef *huart);
+HAL_StatusTypeDef HAL_UART_Abort(UART_HandleTypeDef *huart);
+HAL_StatusTypeDef HAL_UART_AbortReceive(UART_HandleTypeDef *huart);
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart, const uint8_t *data, uint16_t size);
+HAL_StatusTypeDef HAL_UART_Receive_DMA(UART_HandleTypeDef *huart, uint8_t *data, uint16_t size);
+uint32_t Host_DmaCounter(void);
+uint32_t Host_UartFlag(uint32_t flag);
+#define __HAL_DMA_GET_COUNTER(h)   Host_DmaCounter()
+#define __HAL_UART_GET_FLAG(h, f)  Host_UartFlag(f)
+
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart);
+void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart);
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart);
+void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim);
+
+void Error_Handler(void);
+
+#endif /* __MAIN_H */
@@ -0,0 +1,145 @@
+/**
+  ******************************************************************************
+  * @file    mines_test.c
+  * @brief   Mine placement: every board has exactly mineCount mines and
+  *          matching counts, the first click never loses, mines land evenly
+  *          over the cells, and Floyd sampling is timed against the original
+  *          rejection sampling up to 90% density.
+  ******************************************************************************
+  */
+
+#include "firmware.h"
+#include "baseline.h"
+#include <math.h>
+
+#define BOARDS       20000
+#define BENCH_BOARDS 20000
+
+static uint16_t CountMines(void)
+{
+    uint16_t n = 0;
+    for(uint8_t i=0;i<BOARD_STRIDE;i++)
+        n += Popcount32(mineRows[i]);
+    return n;
+}
+
+/* Mines only on the board, and every count matches a recount */
+static void CheckBoard(void)
+{
+    CHECK(CountMines() == mineCount);
+    CHECK(!mineRows[0] && !mineRows[fieldSize+1]);
+
+    Baseline_LoadBoard();
+    for(uint8_t i=1;i<=fieldSize;i++)
+    {
+        CHECK(!(mineRows[i] & ~rowMask));
+        for(uint8_t j=1;j<=fieldSize;j++)
+            if(!(mineRows[i] & BIT(j)))
+                CHECK(CellValue(i,j) == Baseline_CountAdjacent(i-1,j-1));
+    }
+}
+
+static void Click(uint8_t row, uint8_t col)
+{
+    uint8_t p[2] = { row, col };
+    HandleClick(p, 2);
+    Host_TxRun();
+    Host_TxClear();
+}
+
+/* A click on every cell in turn, each as the first of a new game */
+static void TestFirstClick(uint8_t level)
+{
+    uint32_t moved = 0;
+    for(uint32_t b=0;b<BOARDS;b++)
+    {
+        hostTick = b;
+        GenerateMinefield(level);
+        CheckBoard();
+
+        uint8_t x = b % fieldSize, y = (b / fieldSize) % fieldSize;
+        uint8_t wasMine = (mineRows[x+1] & BIT(y+1)) != 0;
+
+        Click(x, y);
+        CHECK(!(mineRows[x+1] & BIT(y+1)));
+        CHECK(openRows[x+1] & BIT(y+1));
+        CHECK(gameResult != STATUS_LOSE);
+        CheckBoard();
+        moved += wasMine;
+
+        /* Later clicks are not protected */
+        for(uint8_t i=1;i<=fieldSize && !gameOver;i++)
+            if(mineRows[i] & ~openRows[i] & rowMask)
+            {
+                Click(i-1, __builtin_ctz(mineRows[i]) - 1);
+                CHECK(gameResult == STATUS_LOSE);
+            }
+    }
+    printf("level %c: %u boards, %u first clicks on a mine moved it\n", level, BOARDS, moved);
+}
+
+/* Chi-square of mine hits per cell over many HARD boards */
+static void TestDistribution(void)
+{
+    static uint32_t hits[MAX_SIZE][MAX_SIZE];
+    memset(hits, 0, sizeof(hits));
+
+    for(uint32_t b=0;b<BOARDS;b++)
+    {
+        hostTick = b;
+        GenerateMinefield(DIFF_HARD);
+        for(uint8_t i=0;i<fieldSize;i++)
+            for(uint8_t j=0;j<fieldSize;j++)
+                hits[i][j] += (mineRows[i+1] >> (j+1)) & 1;
+    }
+
+    uint16_t cells = (uint16_t)fieldSize*fieldSize;
+    double expected = (double)BOARDS * mineCount / cells, chi2 = 0;
+    for(uint8_t i=0;i<fieldSize;i++)
+        for(uint8_t j=0;j<fieldSize;j++)
+            chi2 += (hits[i][j] - expected) * (hits[i][j] - expected) / expected;
+
+    /* Mean cells-1, deviation sqrt(2(cells-1)): 5 deviations out is a biased placer */
+    double limit = (cells - 1) + 5 * sqrt(2.0 * (cells - 1));
+    printf("HARD: chi-square %.1f over %u cells (uniform below %.1f)\n", chi2, cells, limit);
+    CHECK(chi2 < limit);
+}
+
+/* Placement alone, on a HARD-sized board filled to each density */
+static void BenchDensity(void)
+{
+    printf("15x15 placement   Floyd      rejection\n");
+    for(uint8_t pct=10;pct<=90;pct+=10)
+    {
+        uint8_t mines = (uint8_t)(225 * pct / 100);
+
+        fieldSize = 15;
+        mineCount = mines;
+        double t0 = Host_Seconds();
+        for(uint32_t b=0;b<BENCH_BOARDS;b++)
+        {
+            ClearField();
+            PlaceMines();
+        }
+        double t1 = Host_Seconds();
+        CHECK(CountMines() == mines);
+
+        srand(pct);
+        for(uint32_t b=0;b<BENCH_BOARDS;b++)
+            Baseline_PlaceMines(15, mines);
+        double t2 = Host_Seconds();
+
+        printf("%3u%% %3u mines  %7.0f ns  %7.0f ns\n", pct, mines,
+               (t1 - t0) / BENCH_BOARDS * 1e9, (t2 - t1) / BENCH_BOARDS * 1e9);
+    }
+}
+
+int main(void)
+{
+    TestFirstClick(DIFF_EASY);
+    TestFirstClick(DIFF_MEDIUM);
+    TestFirstClick(DIFF_HARD);
+    TestDistribution();
+    BenchDensity();
+    return 0;
+}
@@ -0,0 +1,150 @@
+/**
+  ******************************************************************************
+  * @file    rx_gate_test.c
+  * @brief   A corrupted length swallows the frames behind it; once the CRC
+  *          fails, the rescan finds them whole in rxBuf. They must still be
+  *          handled one at a time behind TX_CanAccept(), so a reply that is
+  *          rendered lazily from the board or echoBuf is not overwritten by
+  *          the next request while it goes out.
+  ******************************************************************************
+  */
+
+#include "firmware.h"
+
+#define BIG_FLOOD 40    /* cells: the CLICK reply outgrows both TX windows */
+
+static uint32_t replyAt = 0;
+
+static void ClearReplies(void)
+{
+    Host_TxClear();
+    replyAt = 0;
+}
+
+/* A frame as Test_Send puts it on the wire, but claiming badLen bytes of payload */
+static void SendBadLength(uint8_t cmd, uint8_t seq, const uint8_t *payload, uint16_t len, uint16_t badLen)
+{
+    uint8_t f[RX_BUFFER_SIZE];
+    f[0] = FRAME_SOF;
+    f[1] = cmd;
+    f[2] = seq;
+    f[3] = len & 0xFF;
+    f[4] = len >> 8;
+    if(len) memcpy(f + RX_HEADER_SIZE, payload, len);
+    uint32_t crc = Host_Crc(CRC_INIT_VALUE, f, RX_HEADER_SIZE + len);
+    for(uint8_t i=0;i<FRAME_CRC_SIZE;i++)
+        f[RX_HEADER_SIZE + len + i] = crc >> (8*i);
+    f[3] = badLen & 0xFF;
+    f[4] = badLen >> 8;
+    Host_RxWrite(f, RX_HEADER_SIZE + len + FRAME_CRC_SIZE);
+}
+
+static void StartGame(uint32_t seed)
+{
+    uint8_t level = DIFF_HARD;
+    rngState = seed;
+    Test_Send(CMD_MINEFIELD, 1, &level, 1);
+    Test_Run();
+    ClearReplies();
+}
+
+/* Cells listed in a CLICK reply: each open, with its value, and not already
+   listed by an earlier reply in seen */
+static uint16_t CheckCells(const Reply *r, uint32_t *seen)
+{
+    CHECK(r->cmd == CMD_CLICK && r->len % 3 == 0);
+    for(uint16_t i=0;i<r->len;i+=3)
+    {
+        uint8_t x = r->payload[i] + 1, y = r->payload[i+1] + 1;
+        CHECK(x <= fieldSize && y <= fieldSize);
+        CHECK(openRows[x] & BIT(y));
+        CHECK(!(seen[x] & BIT(y)));
+        CHECK(r->payload[i+2] == CellValue(x,y));
+        seen[x] |= BIT(y);
+    }
+    return r->len / 3;
+}
+
+static void TestSwallowedClicks(void)
+{
+    /* A board whose first click at (7,7) opens a big flood, and a safe cell
+       it leaves closed */
+    uint32_t seed = 1;
+    uint8_t far[2] = { 0, 0 };
+    for(;;seed++)
+    {
+        StartGame(seed);
+        Test_Send(CMD_CLICK, 2, (const uint8_t[]){ 7, 7 }, 2);
+        Test_Run();
+        Reply r;
+        CHECK(Test_NextReply(&replyAt, &r));
+        if(r.len / 3 < BIG_FLOOD) continue;
+
+        uint8_t found = 0;
+        for(uint8_t x=1;x<=fieldSize && !found;x++)
+            for(uint8_t y=1;y<=fieldSize && !found;y++)
+                if(!((openRows[x] | mineRows[x]) & BIT(y)))
+                {
+                    far[0] = x - 1;
+                    far[1] = y - 1;
+                    found = 1;
+                }
+        if(found) break;
+    }
+
+    /* Length 24 makes the bad frame 33 bytes: itself and both CLICKs behind it */
+    StartGame(seed);
+    SendBadLength(CMD_CLICK, 10, (const uint8_t[]){ 1, 1 }, 2, 24);
+    Test_Send(CMD_CLICK, 11, (const uint8_t[]){ 7, 7 }, 2);
+    Test_Send(CMD_CLICK, 12, far, 2);
+    Test_Run();
+
+    uint32_t seen[BOARD_STRIDE] = { 0 };
+    uint16_t cells = 0;
+    Reply r;
+    CHECK(Test_NextReply(&replyAt, &r) && r.seq == 11 && r.status == STATUS_OK);
+    CHECK(r.len / 3 >= BIG_FLOOD);
+    cells += CheckCells(&r, seen);
+    CHECK(Test_NextReply(&replyAt, &r) && r.seq == 12);
+    cells += CheckCells(&r, seen);
+    CHECK(!Test_NextReply(&replyAt, &r));
+
+    uint16_t open = 0;
+    for(uint8_t x=1;x<=fieldSize;x++)
+        open += Popcount32(openRows[x]);
+    CHECK(cells == open);
+    printf("corrupted length over two CLICKs: both replies carry their own %u cells\n", cells);
+}
+
+static void TestSwallowedEchoes(void)
+{
+    uint8_t a[121], b[121];
+    for(uint8_t i=0;i<sizeof(a);i++) { a[i] = i; b[i] = 0xFF - i; }
+
+    /* The LINK reply holds the first TX window, so the first ECHO is still
+       being rendered when the second is found. Length 260 makes the bad
+       frame 269 bytes: itself and both ECHOs. */
+    ClearReplies();
+    Test_Send(CMD_LINK, 19, NULL, 0);
+    SendBadLength(CMD_ECHO, 20, NULL, 0, 2 * (RX_HEADER_SIZE + sizeof(a) + FRAME_CRC_SIZE));
+    Test_Send(CMD_ECHO, 21, a, sizeof(a));
+    Test_Send(CMD_ECHO, 22, b, sizeof(b));
+    Test_Run();
+
+    Reply r;
+    CHECK(Test_NextReply(&replyAt, &r) && r.cmd == CMD_LINK && r.seq == 19);
+    CHECK(Test_NextReply(&replyAt, &r) && r.seq == 21 && r.len == sizeof(a));
+    CHECK(!memcmp(r.payload, a, sizeof(a)));
+    CHECK(Test_NextReply(&replyAt, &r) && r.seq == 22 && r.len == sizeof(b));
+    CHECK(!memcmp(r.payload, b, sizeof(b)));
+    CHECK(!Test_NextReply(&replyAt, &r));
+    printf("corrupted length over two ECHOs: both payloads intact\n");
+}
+
+int main(void)
+{
+    Test_Init();
+    TestSwallowedClicks();
+    TestSwallowedEchoes();
+    return 0;
+}
@@ -0,0 +1,158 @@
+/**
+  ******************************************************************************
+  * @file    rx_ring_test.c
+  * @brief   The RX ring under UART_Task: frames across the wrap, a wrap
+  *          interrupt that runs late, the DMA lapping a reader held back by
+  *          a pinned reply, and a UART error in the middle of a frame.
+  ******************************************************************************
+  */
+
+#include "firmware.h"
+
+static uint32_t replyAt = 0;
+
+static void SendEcho(uint8_t seq, uint16_t len)
+{
+    uint8_t p[ECHO_MAX_PAYLOAD];
+    for(uint16_t i=0;i<len;i++) p[i] = (uint8_t)(seq + i);
+    Test_Send(CMD_ECHO, seq, p, len);
+}
+
+/* The next reply is the ECHO of SendEcho(seq, len) */
+static void ExpectEcho(uint8_t seq, uint16_t len)
+{
+    Reply r;
+    CHECK(Test_NextReply(&replyAt, &r));
+    CHECK(r.cmd == CMD_ECHO && r.seq == seq && r.status == STATUS_OK && r.len == len);
+    for(uint16_t i=0;i<len;i++)
+        CHECK(r.payload[i] == (uint8_t)(seq + i));
+}
+
+static void ExpectNoReply(void)
+{
+    Reply r;
+    CHECK(!Test_NextReply(&replyAt, &r));
+}
+
+/* A HARD board is longer than both TX windows, so its reply stays pinned and
+   UART_Task stops reading until the windows are sent */
+static void HoldReader(uint8_t seq)
+{
+    uint8_t level = DIFF_HARD;
+    Test_Send(CMD_MINEFIELD, seq, &level, 1);
+    UART_Task();
+    CHECK(txPinned);
+}
+
+static void ExpectBoard(uint8_t seq)
+{
+    Reply r;
+    CHECK(Test_NextReply(&replyAt, &r));
+    CHECK(r.cmd == CMD_MINEFIELD && r.seq == seq && r.len == 15*15);
+}
+
+/* Odd frame lengths walk the frames over the wrap at every offset */
+static void TestAcrossWrap(void)
+{
+    uint8_t seq = 1;
+    for(uint16_t n=0;n<200;n++,seq++)
+    {
+        SendEcho(seq, n % 53);
+        Test_Run();
+        ExpectEcho(seq, n % 53);
+    }
+    ExpectNoReply();
+    CHECK(!rxOverruns);
+    printf("across the wrap: %u frames, %u laps\n", seq - 1, rxLaps);
+}
+
+/* The counter has reloaded but rxLaps has not moved yet */
+static void TestLateWrapIrq(void)
+{
+    for(uint8_t k=0;k<8;k++)
+    {
+        hostRxLapHeld = 1;
+        for(uint8_t seq=0;seq<4;seq++) SendEcho(seq, 100);
+        Test_Run();
+        hostRxLapHeld = 0;
+        Host_RxLapIrq();
+        Test_Run();
+        for(uint8_t seq=0;seq<4;seq++) ExpectEcho(seq, 100);
+    }
+    ExpectNoReply();
+    CHECK(!rxOverruns);
+    printf("late wrap interrupt: read on without a false overrun\n");
+}
+
+static void TestOverrun(void)
+{
+    /* A whole ring of unread bytes is still intact */
+    HoldReader(1);
+    for(uint8_t seq=2;seq<6;seq++) SendEcho(seq, RX_RING_SIZE/4 - RX_HEADER_SIZE - FRAME_CRC_SIZE);
+    Test_Run();
+    ExpectBoard(1);
+    for(uint8_t seq=2;seq<6;seq++) ExpectEcho(seq, RX_RING_SIZE/4 - RX_HEADER_SIZE - FRAME_CRC_SIZE);
+    ExpectNoReply();
+    CHECK(!rxOverruns);
+
+    /* One byte more and the oldest is gone: everything unread is dropped */
+    HoldReader(1);
+    for(uint8_t seq=2;seq<6;seq++) SendEcho(seq, RX_RING_SIZE/4 - RX_HEADER_SIZE - FRAME_CRC_SIZE);
+    SendEcho(6, 0);
+    Test_Run();
+    ExpectBoard(1);
+    ExpectNoReply();
+    CHECK(rxOverruns == 1);
+
+    /* Lapped with a frame half read: its tail must not be joined to it */
+    HoldReader(7);
+    SendEcho(8, 40);
+    Host_RxWrite((const uint8_t[]){ FRAME_SOF, CMD_ECHO, 9, 200, 0 }, RX_HEADER_SIZE);
+    for(uint8_t seq=10;seq<18;seq++) SendEcho(seq, 60);
+    Test_Run();
+    ExpectBoard(7);
+    ExpectNoReply();
+    CHECK(rxOverruns == 2);
+
+    for(uint8_t seq=20;seq<24;seq++) SendEcho(seq, 30);
+    Test_Run();
+    for(uint8_t seq=20;seq<24;seq++) ExpectEcho(seq, 30);
+    ExpectNoReply();
+    printf("overrun: detected %u times, parsing resynced\n", rxOverruns);
+}
+
+/* The error interrupt only asks for a restart; the read position is the
+   main loop's to reset */
+static void TestErrorRestart(void)
+{
+    SendEcho(1, 50);
+    Test_Run();
+    ExpectEcho(1, 50);
+
+    Host_RxWrite((const uint8_t[]){ FRAME_SOF, CMD_ECHO, 2, 50, 0, 1, 2 }, 7);
+    UART_Task();
+    uint32_t read = rxRead;
+    CHECK(rxIndex == 7);
+
+    HAL_UART_ErrorCallback(&huart2);
+    CHECK(rxRestart && rxRead == read && rxIndex == 7);
+
+    UART_Task();
+    CHECK(!rxRestart && !rxRead && !rxIndex && !hostRxWritten);
+
+    SendEcho(3, 50);
+    Test_Run();
+    ExpectEcho(3, 50);
+    ExpectNoReply();
+    printf("error: reception restarted from the main loop\n");
+}
+
+int main(void)
+{
+    Test_Init();
+    TestAcrossWrap();
+    TestLateWrapIrq();
+    TestOverrun();
+    TestErrorRestart();
+    return 0;
+}
@@ -0,0 +1,119 @@
+/**
+  ******************************************************************************
+  * @file    sentinel_bench.c
+  * @brief   What the sentinel border saves. First the neighbour walk alone:
+  *          counting every cell of a byte board with bounds checks against
+  *          the same board padded with a border and walked with
+  *          neighbourOffset. Then a whole game: generation plus opening
+  *          every cell, the original code against main.c.
+  ******************************************************************************
+  */
+
+#include "firmware.h"
+#include "baseline.h"
+
+#define BOARDS 20000
+
+/* The baseline board with a one-cell border, read through neighbourOffset */
+static int8_t padded[BOARD_STRIDE*BOARD_STRIDE];
+static uint8_t paddedCount[BOARD_STRIDE*BOARD_STRIDE];
+
+static void LoadPadded(void)
+{
+    memset(padded, 0, sizeof(padded));
+    for(uint8_t i=0;i<baseSize;i++)
+        for(uint8_t j=0;j<baseSize;j++)
+            padded[CELL_INDEX(i+1,j+1)] = baseField[i][j] == BASELINE_MINE;
+}
+
+static void CountPadded(void)
+{
+    for(uint8_t i=1;i<=baseSize;i++)
+        for(uint8_t j=1;j<=baseSize;j++)
+        {
+            uint16_t k = CELL_INDEX(i,j);
+            uint8_t cnt = 0;
+            for(uint8_t n=0;n<8;n++)
+                cnt += padded[k + neighbourOffset[n]];
+            paddedCount[k] = cnt;
+        }
+}
+
+static void BenchCount(const char *name, uint8_t level)
+{
+    double checked = 0, sentinel = 0;
+
+    for(uint32_t b=0;b<BOARDS;b++)
+    {
+        hostTick = b;
+        GenerateMinefield(level);
+        Baseline_LoadBoard();
+        LoadPadded();
+
+        double t0 = Host_Seconds();
+        Baseline_CountAll();
+        double t1 = Host_Seconds();
+        CountPadded();
+        double t2 = Host_Seconds();
+        checked += t1 - t0;
+        sentinel += t2 - t1;
+
+        for(uint8_t i=0;i<baseSize;i++)
+            for(uint8_t j=0;j<baseSize;j++)
+                if(baseField[i][j] != BASELINE_MINE)
+                    CHECK(paddedCount[CELL_INDEX(i+1,j+1)] == baseField[i][j]);
+    }
+
+    printf("%-6s count pass   bounds checks %6.0f ns   sentinel %6.0f ns   (x%.1f)\n", name,
+           checked / BOARDS * 1e9, sentinel / BOARDS * 1e9, checked / sentinel);
+}
+
+/* Generation, then a click on every cell still closed, until all are open */
+static void BenchGame(const char *name, uint8_t level)
+{
+    double before = 0, after = 0;
+
+    for(uint32_t b=0;b<BOARDS;b++)
+    {
+        hostTick = b;
+
+        double t0 = Host_Seconds();
+        GenerateMinefield(level);
+        for(uint8_t x=1;x<=fieldSize;x++)
+            for(uint8_t y=1;y<=fieldSize;y++)
+                if(!(openRows[x] & BIT(y))) FloodOpen(x,y);
+        double t1 = Host_Seconds();
+
+        uint8_t size = fieldSize, mines = mineCount;
+        for(uint8_t i=1;i<=fieldSize;i++)
+            CHECK(openRows[i] == rowMask);
+
+        srand(b);
+        double t2 = Host_Seconds();
+        Baseline_PlaceMines(size, mines);
+        Baseline_CountAll();
+        Baseline_ClearOpened();
+        for(uint8_t x=0;x<size;x++)
+            for(uint8_t y=0;y<size;y++)
+                Baseline_FloodOpen(x,y);
+        double t3 = Host_Seconds();
+
+        CHECK(baseOpenedTotal == (uint16_t)size*size);
+        after += t1 - t0;
+        before += t3 - t2;
+    }
+
+    printf("%-6s full game    original     %6.0f ns   main.c   %6.0f ns   (x%.1f)\n", name,
+           before / BOARDS * 1e9, after / BOARDS * 1e9, before / after);
+}
+
+int main(void)
+{
+    BenchCount("EASY", DIFF_EASY);
+    BenchCount("MEDIUM", DIFF_MEDIUM);
+    BenchCount("HARD", DIFF_HARD);
+    BenchGame("EASY", DIFF_EASY);
+    BenchGame("MEDIUM", DIFF_MEDIUM);
+    BenchGame("HARD", DIFF_HARD);
+    return 0;
+}
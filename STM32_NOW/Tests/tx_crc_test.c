@@ -0,0 +1,50 @@
+/**
+  ******************************************************************************
+  * @file    tx_crc_test.c
+  * @brief   The CRC of frames split over TX windows. ECHO payloads of every
+  *          length go out behind a varying number of TIMER frames, so header
+  *          plus payload ends at every offset of a window, the window edge
+  *          included, and every reply is checked against a software CRC.
+  ******************************************************************************
+  */
+
+#include "firmware.h"
+
+#define MAX_TIMERS 6    /* TIMER frames queued ahead of the ECHO */
+
+static uint32_t replyAt = 0;
+
+int main(void)
+{
+    uint32_t frames = 0;
+
+    Test_Init();
+    for(uint8_t timers=0;timers<=MAX_TIMERS;timers++)
+        for(uint16_t len=0;len<=ECHO_MAX_PAYLOAD;len++)
+        {
+            uint8_t p[ECHO_MAX_PAYLOAD];
+            for(uint16_t i=0;i<len;i++) p[i] = (uint8_t)(len + i * 31);
+
+            for(uint8_t t=0;t<timers;t++)
+                TX_Enqueue(CMD_TIMER, 0, STATUS_OK, t);
+            Test_Send(CMD_ECHO, (uint8_t)len, p, len);
+            Test_Run();
+
+            Reply r;
+            for(uint8_t t=0;t<timers;t++)
+            {
+                CHECK(Test_NextReply(&replyAt, &r));
+                CHECK(r.cmd == CMD_TIMER && r.len == 2 && r.payload[0] == t);
+            }
+
+            CHECK(Test_NextReply(&replyAt, &r));
+            CHECK(r.cmd == CMD_ECHO && r.seq == (uint8_t)len && r.len == len);
+            CHECK(!memcmp(r.payload, p, len));
+            CHECK(replyAt == hostTxLen);
+
+            frames += timers + 1;
+        }
+
+    printf("%u frames split over TX windows, every CRC good\n", frames);
+    return 0;
+}